@@ -0,0 +1,125 @@
+#include "AudioWriter.h"
+
+#include "logger.h"
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+using namespace std::chrono_literals;
+
+namespace Emulation {
+	/* ***********************************************************************************************************
+		CONSTRUCTOR
+	*********************************************************************************************************** */
+	AudioWriter::AudioWriter(const std::string& _path, const int& _channels, const int& _sampling_rate) : channels(_channels), samplingRate(_sampling_rate) {
+		file.open(_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			LOG_ERROR("[emu] opening ", _path, " for audio output");
+			return;
+		}
+
+		// sizes get patched once the writer thread finished
+		WriteHeader(0);
+
+		running.store(true);
+		writerThread = std::thread([this]() -> void { ProcessWrites(); });
+		LOG_INFO("[emu] writing audio to ", _path);
+	}
+
+	AudioWriter::~AudioWriter() {
+		running.store(false);
+		if (writerThread.joinable()) {
+			writerThread.join();
+		}
+
+		if (file.is_open()) {
+			file.seekp(0);
+			WriteHeader((u32)(framesWritten.load() * channels * sizeof(i16)));
+			file.close();
+		}
+	}
+
+	bool AudioWriter::IsOpen() const {
+		return file.is_open();
+	}
+
+	/* ***********************************************************************************************************
+		EMULATION THREAD
+	*********************************************************************************************************** */
+	void AudioWriter::Write(const float* _frames, const int& _num) {
+		if (!running.load(std::memory_order_relaxed)) { return; }
+
+		while (!ring.Push(_frames, _num * channels)) {
+			std::this_thread::yield();
+		}
+	}
+
+	float AudioWriter::GetSecondsWritten() const {
+		return (float)framesWritten.load() / samplingRate;
+	}
+
+	/* ***********************************************************************************************************
+		WRITER THREAD
+	*********************************************************************************************************** */
+	void AudioWriter::ProcessWrites() {
+		std::vector<float> chunk(AUDIO_WRITER_CHUNK_SIZE);
+		std::vector<i16> pcm(AUDIO_WRITER_CHUNK_SIZE);
+
+		// the ring only ever holds whole frames, popping a multiple of the channels keeps them intact
+		size_t chunk_size = AUDIO_WRITER_CHUNK_SIZE - (AUDIO_WRITER_CHUNK_SIZE % channels);
+
+		while (true) {
+			size_t num = ring.Pop(chunk.data(), chunk_size);
+
+			if (num == 0) {
+				if (!running.load()) { break; }
+				std::this_thread::sleep_for(1ms);
+				continue;
+			}
+
+			for (size_t i = 0; i < num; i++) {
+				pcm[i] = (i16)(std::clamp(chunk[i], -1.f, 1.f) * 0x7FFF);
+			}
+
+			file.write((const char*)pcm.data(), num * sizeof(i16));
+			framesWritten.fetch_add(num / channels);
+		}
+	}
+
+	// canonical 44 byte header for up to 2 channels, WAVE_FORMAT_EXTENSIBLE (68 bytes) with a speaker layout above,
+	// little endian like the samples
+	void AudioWriter::WriteHeader(const u32& _data_size) {
+		auto write_u32 = [this](const u32& _val) { file.write((const char*)&_val, sizeof(u32)); };
+		auto write_u16 = [this](const u16& _val) { file.write((const char*)&_val, sizeof(u16)); };
+
+		bool extensible = channels > 2;
+		u32 fmt_size = extensible ? 40 : 16;
+
+		file.write("RIFF", 4);
+		write_u32(4 + (8 + fmt_size) + 8 + _data_size);
+		file.write("WAVE", 4);
+
+		file.write("fmt ", 4);
+		write_u32(fmt_size);
+		write_u16(extensible ? WAV_FORMAT_EXTENSIBLE : WAV_FORMAT_PCM);
+		write_u16((u16)channels);
+		write_u32((u32)samplingRate);
+		write_u32((u32)(samplingRate * channels * sizeof(i16)));
+		write_u16((u16)(channels * sizeof(i16)));
+		write_u16(16);
+
+		if (extensible) {
+			// KSDATAFORMAT_SUBTYPE_PCM {00000001-0000-0010-8000-00AA00389B71}
+			static const u8 subformat_pcm[16] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+			write_u16(22);						// size of the extension
+			write_u16(16);						// valid bits per sample
+			write_u32(channels == 4 ? WAV_SPEAKER_QUAD : 0);
+			file.write((const char*)subformat_pcm, sizeof(subformat_pcm));
+		}
+
+		file.write("data", 4);
+		write_u32(_data_size);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Offline audio sink: takes the mixed frames from the emulation thread instead of the audio backend and writes
+*	them as 16 bit PCM WAV file on a separate writer thread. The emulation thread waits when the writer falls
+*	behind instead of dropping frames, so the file only depends on the emulated time and can be compared
+*	byte for byte between runs.
+*	The frames have to be interleaved in the WAV speaker order: left, right for stereo and front left, front right,
+*	back left, back right for quad (WAV_SPEAKER_QUAD).
+*/
+
+#include <string>
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+#include "defs.h"
+#include "RingBuffer.h"
+
+#define AUDIO_WRITER_RING_SIZE          (1 << 18)           // floats
+#define AUDIO_WRITER_CHUNK_SIZE         4096                // floats, converted and written at once
+
+#define WAV_FORMAT_PCM                  0x0001
+#define WAV_FORMAT_EXTENSIBLE           0xFFFE              // required for more than 2 channels
+#define WAV_SPEAKER_QUAD                0x00000033          // front left, front right, back left, back right
+
+namespace Emulation {
+	class AudioWriter {
+	public:
+		AudioWriter(const std::string& _path, const int& _channels, const int& _sampling_rate);
+		~AudioWriter();
+
+		bool IsOpen() const;
+
+		// emulation thread, _num interleaved frames in WAV speaker order
+		void Write(const float* _frames, const int& _num);
+		float GetSecondsWritten() const;
+
+	private:
+		std::ofstream file;
+		int channels;
+		int samplingRate;
+
+		RingBuffer<float> ring = RingBuffer<float>(AUDIO_WRITER_RING_SIZE);
+		alignas(64) std::atomic<u64> framesWritten = 0;
+
+		std::thread writerThread;
+		alignas(64) std::atomic<bool> running = false;
+
+		void ProcessWrites();
+		void WriteHeader(const u32& _data_size);
+	};
+}
\ No newline at end of file
@@ -2,17 +2,21 @@
 
 #include "HardwareMgr.h"
 #include "BaseCartridge.h"
+#include "VHardwareTypes.h"
+#include "FrameProfiler.h"
 
 namespace Emulation {
+	class Machine;
+
 	class BaseAPU {
 	public:
-		// get/reset instance
-		static std::shared_ptr<BaseAPU> s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge);
-		static std::shared_ptr<BaseAPU> s_GetInstance();
-		static void s_ResetInstance();
-		virtual void Init() = 0;
-		int GetChunkId() const;
-		void NextChunk();
+		// creates the console specific component, Init wires it to the other components of its machine
+		static std::shared_ptr<BaseAPU> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+		virtual void Init(const Machine& _machine) = 0;
+
+		// run-ahead state slot, see Machine::SaveState
+		virtual void SaveState() = 0;
+		virtual void RestoreState() = 0;
 
 		// clone/assign protection
 		BaseAPU(BaseAPU const&) = delete;
@@ -25,16 +29,32 @@ namespace Emulation {
 		virtual void SampleAPU(std::vector<std::complex<float>>& _data, const int& _samples) = 0;
 		virtual void GenerateSamples(const int& _ticks) = 0;
 
+		// audio clock pacing: fill level (0-1) of the buffer between emulation and audio backend, the emulation speed
+		// gets slaved to it while the ratio (1 +- a fraction of a percent) stretches the generated samples
+		virtual float GetBufferFill() const = 0;
+		virtual void SetResamplingRatio(const float& _ratio) = 0;
+
+		// skips the sample synthesis while nobody consumes the output (e.g. fast forward), the register visible state keeps running
+		virtual void SetSynthesisBypass(const bool& _bypass) = 0;
+
+		virtual void GetHardwareInfo(std::vector<data_entry>& _hardware_info) const = 0;
+
+		// offline rendering: the samples get written to _path instead of the audio backend, has to be set before Init
+		void SetOfflineOutput(const std::string& _path);
+		// emulation thread, writes the remaining samples and closes the file, later samples get discarded
+		virtual void FinishOfflineOutput() = 0;
+		// no audio backend (e.g. batch runs), without offline output the synthesis gets bypassed
+		void SetHeadless(const bool& _headless);
+
 	protected:
 		// constructor
 		BaseAPU() {}
 		virtual ~BaseAPU() {}
 
-		int m_physSamplingRate = 0;
-
-	private:
-		int m_audioChunkId = 0;
+		FrameProfiler* profiler = nullptr;
 
-		static std::weak_ptr<BaseAPU> m_Instance;
+		int m_physSamplingRate = 0;
+		std::string offlineOutput = "";
+		bool headless = false;
 	};
 }
\ No newline at end of file
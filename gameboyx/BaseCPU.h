@@ -14,12 +14,16 @@
 #include "BaseMMU.h"
 #include "BaseGPU.h"
 #include "BaseAPU.h"
+#include "BaseCTRL.h"
 #include "BaseCartridge.h"
 #include "defs.h"
 #include "VHardwareTypes.h"
+#include "FrameProfiler.h"
 #include <map>
 
 namespace Emulation {
+	class Machine;
+
 	using assembly_table = std::vector<std::tuple<int, instr_entry>>;
 
 	struct assembly_tables : std::vector<assembly_table> {
@@ -42,11 +46,13 @@ namespace Emulation {
 
 	class BaseCPU {
 	public:
-		// get/reset instance
-		static std::shared_ptr<BaseCPU> s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge);
-		static std::shared_ptr<BaseCPU> s_GetInstance();
-		static void s_ResetInstance();
-		virtual void Init() = 0;
+		// creates the console specific component, Init wires it to the other components of its machine
+		static std::shared_ptr<BaseCPU> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+		virtual void Init(const Machine& _machine) = 0;
+
+		// run-ahead state slot, see Machine::SaveState
+		virtual void SaveState() = 0;
+		virtual void RestoreState() = 0;
 
 		// clone/assign protection
 		BaseCPU(BaseCPU const&) = delete;
@@ -61,6 +67,8 @@ namespace Emulation {
 		virtual void GetHardwareInfo(std::vector<data_entry>& _hardware_info) const = 0;
 		virtual void GetInstrDebugFlags(std::vector<reg_entry>& _register_values, std::vector<reg_entry>& _flag_values, std::vector<reg_entry>& _misc_values) const = 0;
 		virtual void UpdateDebugData(debug_data* _data) const = 0;
+		// bank -1: PC outside of the ROM
+		virtual void GetDebugIndex(int& _bank, int& _pc) const = 0;
 
 		virtual void GenerateAssemblyTables(std::shared_ptr<BaseCartridge> _cartridge) = 0;
 		virtual void GenerateTemporaryAssemblyTable(assembly_tables& _table) = 0;
@@ -75,6 +83,9 @@ namespace Emulation {
 		int GetClockCycles() const;
 		void ResetClockCycles();
 
+		// debugger only, calls and returns get tracked while enabled, enabling starts with an empty callstack
+		void SetCallstackEnable(const bool& _enable);
+
 		virtual void GetMemoryTypes(std::map<int, std::string>& _map) const = 0;
 
 		assembly_tables& GetAssemblyTables();
@@ -87,12 +98,18 @@ namespace Emulation {
 		std::weak_ptr<BaseMMU> m_MmuInstance;
 		std::weak_ptr<BaseGPU> m_GraphicsInstance;
 		std::weak_ptr<BaseAPU> m_SoundInstance;
+		std::weak_ptr<BaseCTRL> m_ControlInstance;
+		FrameProfiler* profiler = nullptr;
 
 		int currentTicks = 0;
 		int ticksPerFrame = 0;
 		int tickCounter = 0;
 
-		std::vector<callstack_data> callstack;
+		// ring, deeper (or unbalanced) call chains overwrite the oldest entries
+		std::array<callstack_data, DEBUG_CALLSTACK_DEPTH> callstack = {};
+		int callstackDepth = 0;						// calls - returns
+		int callstackSize = 0;						// entries still held by the ring
+		bool callstackEnable = false;
 
 		virtual void ExecuteInstruction() = 0;
 		virtual bool CheckInterrupts() = 0;
@@ -100,8 +117,5 @@ namespace Emulation {
 		virtual void InitRegisterStates() = 0;
 
 		assembly_tables asmTables;
-
-	private:
-		static std::weak_ptr<BaseCPU> m_Instance;
 	};
 }
\ No newline at end of file
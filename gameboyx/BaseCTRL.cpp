@@ -3,33 +3,77 @@
 
 #include "logger.h"
 
-namespace Emulation {
-	std::weak_ptr<BaseCTRL> BaseCTRL::m_Instance;
+#include <chrono>
 
-	std::shared_ptr<BaseCTRL> BaseCTRL::s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge) {
-		std::shared_ptr<BaseCTRL> ptr = m_Instance.lock();
+using namespace std::chrono;
 
-		if (!ptr) {
-			switch (_cartridge->console) {
-			case GB:
-			case GBC:
-				ptr = std::static_pointer_cast<BaseCTRL>(std::make_shared<Gameboy::GameboyCTRL>(_cartridge));
-				break;
-			}
+namespace Emulation {
+	std::shared_ptr<BaseCTRL> BaseCTRL::s_Create(std::shared_ptr<BaseCartridge> _cartridge) {
+		std::shared_ptr<BaseCTRL> ptr;
 
-			m_Instance = ptr;
+		switch (_cartridge->console) {
+		case GB:
+		case GBC:
+			ptr = std::static_pointer_cast<BaseCTRL>(std::make_shared<Gameboy::GameboyCTRL>(_cartridge));
+			break;
 		}
 
 		return ptr;
 	}
 
-	std::shared_ptr<BaseCTRL> BaseCTRL::s_GetInstance() {
-		return m_Instance.lock();
+	/* ***********************************************************************************************************
+		INPUT QUEUE
+	*********************************************************************************************************** */
+	bool BaseCTRL::PushInput(const int& _player, const SDL_GameControllerButton& _key, const bool& _pressed) {
+		input_event event = {};
+		event.player = _player;
+		event.button = _key;
+		event.pressed = _pressed;
+		event.timestamp = (u64)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+
+		// single producer, the state gets published before the event so a latch never misses a queued one
+		u64 published = inputState.load(std::memory_order_relaxed);
+		u32 state = (u32)published;
+		if (_player == 0 && _key >= 0 && _key < 32) {
+			state = _pressed ? state | (1u << _key) : state & ~(1u << _key);
+		}
+		event.sequence = (u32)(published >> 32) + 1;
+		inputState.store(((u64)event.sequence << 32) | state, std::memory_order_release);
+
+		return inputQueue.Push(&event, 1);
+	}
+
+	bool BaseCTRL::InputPending() const {
+		return inputQueue.Size() > 0;
 	}
 
-	void BaseCTRL::s_ResetInstance() {
-		if (m_Instance.lock()) {
-			m_Instance.reset();
+	void BaseCTRL::ProcessInputs() {
+		if (inputFrozen) { return; }
+
+		u64 now = (u64)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+
+		input_event event;
+		while (inputQueue.Pop(&event, 1) == 1) {
+			// replaying an event a latch already covered would apply an outdated press or release
+			if ((i32)(event.sequence - appliedSequence) > 0) {
+				appliedSequence = event.sequence;
+				if (event.pressed) {
+					SetKey(event.player, event.button);
+				} else {
+					ResetKey(event.player, event.button);
+				}
+			}
+
+			float latency = (float)(now - event.timestamp);
+			inputLatency.store(inputLatency.load(std::memory_order_relaxed) * .9f + latency * .1f, std::memory_order_relaxed);
 		}
 	}
+
+	float BaseCTRL::GetInputLatency() const {
+		return inputLatency.load(std::memory_order_relaxed);
+	}
+
+	void BaseCTRL::SetInputFrozen(const bool& _frozen) {
+		inputFrozen = _frozen;
+	}
 }
\ No newline at end of file
@@ -2,17 +2,31 @@
 #include "HardwareMgr.h"
 
 #include "BaseCartridge.h"
+#include "RingBuffer.h"
+#include "defs.h"
 
 #include <SDL.h>
+#include <atomic>
+
+#define CTRL_INPUT_QUEUE_SIZE           256                 // events
 
 namespace Emulation {
+	class Machine;
+
+	// host input event, timestamped when the GUI thread received it
+	struct input_event {
+		int player = 0;
+		SDL_GameControllerButton button = SDL_CONTROLLER_BUTTON_INVALID;
+		bool pressed = false;
+		u64 timestamp = 0;							// steady clock, microseconds
+		u32 sequence = 0;							// published together with the input state it results in
+	};
+
 	class BaseCTRL {
 	public:
-		// get/reset instance
-		static std::shared_ptr<BaseCTRL> s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge);
-		static std::shared_ptr<BaseCTRL> s_GetInstance();
-		static void s_ResetInstance();
-		virtual void Init() = 0;
+		// creates the console specific component, Init wires it to the other components of its machine
+		static std::shared_ptr<BaseCTRL> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+		virtual void Init(const Machine& _machine) = 0;
 
 		// clone/assign protection
 		BaseCTRL(BaseCTRL const&) = delete;
@@ -24,12 +38,33 @@ namespace Emulation {
 		virtual bool SetKey(const int& _player, const SDL_GameControllerButton& _key) = 0;
 		virtual bool ResetKey(const int& _player, const SDL_GameControllerButton& _key) = 0;
 
+		// input queue: the GUI thread is the only producer and never blocks (false when full), the emulation thread
+		// is the only consumer and applies the events through SetKey/ResetKey once per scanline, unless a latch
+		// already applied a newer state
+		bool PushInput(const int& _player, const SDL_GameControllerButton& _key, const bool& _pressed);
+		bool InputPending() const;
+		void ProcessInputs();
+		float GetInputLatency() const;
+
+		// emulation thread, applies the newest published input state right away (e.g. when the game reads the buttons)
+		virtual void LatchInput() = 0;
+
+		// run-ahead: speculative frames keep the input of the last real frame
+		void SetInputFrozen(const bool& _frozen);
+
 	protected:
 		// constructor
 		BaseCTRL() = default;
 		virtual ~BaseCTRL() {}
 
-	private:
-		static std::weak_ptr<BaseCTRL> m_Instance;
+		RingBuffer<input_event> inputQueue = RingBuffer<input_event>(CTRL_INPUT_QUEUE_SIZE);
+		// pressed buttons of player 1 (low word, bit = SDL_GameControllerButton) and the sequence of the newest event
+		// (high word), published together by the GUI thread with each event
+		alignas(64) std::atomic<u64> inputState = 0;
+		// emulation thread, sequence of the newest event applied either way
+		u32 appliedSequence = 0;
+		// smoothed time between the host event and its application in microseconds
+		alignas(64) std::atomic<float> inputLatency = .0f;
+		bool inputFrozen = false;
 	};
 }
\ No newline at end of file
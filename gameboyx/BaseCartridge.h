@@ -18,7 +18,8 @@ namespace Emulation {
 		CONSOLE,
 		GAME_VER,
 		FILE_NAME,
-		FILE_PATH
+		FILE_PATH,
+		ACCURATE_GRAPHICS
 	};
 
 	class BaseCartridge {
@@ -57,6 +58,12 @@ namespace Emulation {
 		bool ramPresent = false;
 		bool timerPresent = false;
 
+		// battery buffered RAM gets mapped to the save file, without it stays in memory (e.g. concurrent batch jobs)
+		bool persistentSave = true;
+
+		// emulate the PPU dot by dot (pixel FIFO) instead of per scanline
+		bool accurateGraphics = false;
+
 	protected:
 		// constructor
 		explicit BaseCartridge(const Emulation::console_ids& _id, const std::string& _file) : console(_id) {
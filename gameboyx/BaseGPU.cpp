@@ -1,43 +1,110 @@
 #include "BaseGPU.h"
 
 #include "GameboyGPU.h"
+#include "GameboyGPUFIFO.h"
 #include "logger.h"
 
 namespace Emulation {
-	std::weak_ptr<BaseGPU> BaseGPU::m_Instance;
+	std::shared_ptr<BaseGPU> BaseGPU::s_Create(std::shared_ptr<BaseCartridge> _cartridge) {
+		std::shared_ptr<BaseGPU> ptr;
 
-	std::shared_ptr<BaseGPU> BaseGPU::s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge) {
-		std::shared_ptr<BaseGPU> ptr = m_Instance.lock();
-
-		if (!ptr) {
-			switch (_cartridge->console) {
-			case GB:
-			case GBC:
+		switch (_cartridge->console) {
+		case GB:
+		case GBC:
+			if (_cartridge->accurateGraphics) {
+				ptr = std::static_pointer_cast<BaseGPU>(std::make_shared<Gameboy::GameboyGPUFIFO>(_cartridge));
+			} else {
 				ptr = std::static_pointer_cast<BaseGPU>(std::make_shared<Gameboy::GameboyGPU>(_cartridge));
-				break;
 			}
-
-			m_Instance = ptr;
+			break;
 		}
 
 		return ptr;
 	}
 
-	std::shared_ptr<BaseGPU> BaseGPU::s_GetInstance() {
-		return m_Instance.lock();
+	int BaseGPU::GetFrameCount() const {
+		return frameCounter;
+	}
+
+	void BaseGPU::ResetFrameCount() {
+		frameCounter = 0;
+	}
+
+	void BaseGPU::SetRenderBypass(const bool& _bypass) {
+		renderBypass = _bypass;
 	}
 
-	void BaseGPU::s_ResetInstance() {
-		if (m_Instance.lock()) {
-			m_Instance.reset();
+	void BaseGPU::SetPixelFormat(const pixel_formats& _format) {
+		pixelFormat = _format;
+		pixelSize = GetPixelSize(_format);
+	}
+
+	int BaseGPU::GetPixelSize(const pixel_formats& _format) {
+		switch (_format) {
+		case PIXEL_FORMAT_RGB565:
+			return 2;
+		default:
+			return 4;
 		}
 	}
 
-	int BaseGPU::GetFrameCount() const {
-		return frameCounter;
+	// colors internally are 0xRRGGBBAA, the result gets stored as is (native byte order) into the frame buffer
+	u32 BaseGPU::ConvertColor(const u32& _rgba, const pixel_formats& _format) {
+		u8 r = (u8)(_rgba >> 24);
+		u8 g = (u8)(_rgba >> 16);
+		u8 b = (u8)(_rgba >> 8);
+		u8 a = (u8)_rgba;
+
+		u32 color = 0;
+		switch (_format) {
+		case PIXEL_FORMAT_RGBA8888:
+		{
+			u8 bytes[4] = { r, g, b, a };
+			memcpy(&color, bytes, sizeof(u32));
+		}
+			break;
+		case PIXEL_FORMAT_BGRA8888:
+		{
+			u8 bytes[4] = { b, g, r, a };
+			memcpy(&color, bytes, sizeof(u32));
+		}
+			break;
+		case PIXEL_FORMAT_XRGB8888:
+			color = 0xFF000000 | ((u32)r << 16) | ((u32)g << 8) | b;
+			break;
+		case PIXEL_FORMAT_RGB565:
+			color = ((u32)(r >> 3) << 11) | ((u32)(g >> 2) << 5) | (b >> 3);
+			break;
+		}
+
+		return color;
 	}
 
-	void BaseGPU::ResetFrameCount() {
-		frameCounter = 0;
+	int BaseGPU::GetDirtyLineCount() const {
+		return dirtyLineCount.load();
+	}
+
+	void BaseGPU::SetFrameOutput(const bool& _enable) {
+		frameOutput = _enable;
+	}
+
+	bool BaseGPU::GetFrame(gpu_frame& _frame) {
+		return frameBuffer.Read(_frame);
+	}
+
+	// the slot keeps its buffers, after the first frames publishing is a plain copy
+	void BaseGPU::PublishFrame(const int& _width, const int& _height) {
+		if (!frameOutput) { return; }
+
+		gpu_frame& frame = frameBuffer.Write();
+		frame.image_data.assign(imageData.begin(), imageData.end());
+		frame.width = _width;
+		frame.height = _height;
+		frame.pitch = _width * pixelSize;
+		frame.format = pixelFormat;
+		frame.dirty_lines.assign(dirtyLines.begin(), dirtyLines.end());
+		frame.dirty_line_count = dirtyLineCount.load();
+		frame.frame_number = frameCounter;
+		frameBuffer.Publish();
 	}
 }
\ No newline at end of file
@@ -13,17 +13,24 @@
 #include "BaseCartridge.h"
 #include "defs.h"
 #include "VHardwareTypes.h"
+#include "FrameProfiler.h"
+#include "TripleBuffer.h"
 
 #include <vector>
+#include <atomic>
 
 namespace Emulation {
+	class Machine;
+
 	class BaseGPU {
 	public:
-		// get/reset instance
-		static std::shared_ptr<BaseGPU> s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge);
-		static std::shared_ptr<BaseGPU> s_GetInstance();
-		static void s_ResetInstance();
-		virtual void Init() = 0;
+		// creates the console specific component, Init wires it to the other components of its machine
+		static std::shared_ptr<BaseGPU> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+		virtual void Init(const Machine& _machine) = 0;
+
+		// run-ahead state slot, see Machine::SaveState
+		virtual void SaveState() = 0;
+		virtual void RestoreState() = 0;
 
 		// clone/assign protection
 		BaseGPU(BaseGPU const&) = delete;
@@ -41,19 +48,53 @@ namespace Emulation {
 		virtual std::vector<std::tuple<int, std::string, bool>> GetGraphicsDebugSettings() = 0;
 		virtual void SetGraphicsDebugSetting(const bool& _val, const int& _id) = 0;
 
+		// render scanlines on a separate thread, the emulation thread only latches the PPU state per line
+		virtual void SetRenderThreadEnable(const bool& _enable) = 0;
+
+		// frames started while set neither get rasterized nor presented, the emulated PPU timing stays the same
+		void SetRenderBypass(const bool& _bypass);
+
+		virtual void GetHardwareInfo(std::vector<data_entry>& _hardware_info) const = 0;
+
+		// switch between raw and LCD color corrected output of 15 bit colors, applies to palettes written afterwards
+		virtual void SetColorCorrection(const bool& _enable) = 0;
+
+		// output format of the frame buffer, has to be set before Init
+		void SetPixelFormat(const pixel_formats& _format);
+		static u32 ConvertColor(const u32& _rgba, const pixel_formats& _format);
+		static int GetPixelSize(const pixel_formats& _format);
+
+		// number of lines which changed with the last completed frame
+		int GetDirtyLineCount() const;
+
+		// completed frames get published for one reader thread while enabled, GetFrame returns false when nothing new got completed
+		void SetFrameOutput(const bool& _enable);
+		bool GetFrame(gpu_frame& _frame);
+
 	protected:
 		// constructor
 		BaseGPU() = default;
 		virtual ~BaseGPU() {}
 
+		FrameProfiler* profiler = nullptr;
+
 		int frameCounter = 0;
 		int tickCounter = 0;
 
+		bool renderBypass = false;
+
 		std::vector<u8> imageData;
+		pixel_formats pixelFormat = PIXEL_FORMAT_RGBA8888;
+		int pixelSize = 4;
 
-		std::vector<std::atomic<bool>*> graphicsDebugSettings;
+		// written while the lines get drawn, published and cleared with the completed frame
+		std::vector<u64> dirtyLines;
+		alignas(64) std::atomic<int> dirtyLineCount = 0;
+
+		void PublishFrame(const int& _width, const int& _height);
+		bool frameOutput = false;
+		TripleBuffer<gpu_frame> frameBuffer;
 
-	private:
-		static std::weak_ptr<BaseGPU> m_Instance;
+		std::vector<std::atomic<bool>*> graphicsDebugSettings;
 	};
 }
\ No newline at end of file
@@ -13,8 +13,10 @@
 #include "BaseCartridge.h"
 #include "defs.h"
 #include "VHardwareTypes.h"
+#include "FrameProfiler.h"
 
 namespace Emulation {
+	class Machine;
 
 	using memory_type_table = std::vector<std::tuple<int, memory_entry>>;
 
@@ -32,11 +34,13 @@ namespace Emulation {
 
 	class BaseMEM {
 	public:
-		// get/reset instance
-		static std::shared_ptr<BaseMEM> s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge);
-		static std::shared_ptr<BaseMEM> s_GetInstance();
-		static void s_ResetInstance();
-		virtual void Init() = 0;
+		// creates the console specific component, Init wires it to the other components of its machine
+		static std::shared_ptr<BaseMEM> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+		virtual void Init(const Machine& _machine) = 0;
+
+		// run-ahead state slot, see Machine::SaveState
+		virtual void SaveState() = 0;
+		virtual void RestoreState() = 0;
 
 		std::vector<memory_type_tables>& GetMemoryTables();
 
@@ -51,6 +55,8 @@ namespace Emulation {
 		BaseMEM() = default;
 		virtual ~BaseMEM() {}
 
+		FrameProfiler* profiler = nullptr;
+
 		// members
 		virtual void InitMemory(std::shared_ptr<BaseCartridge> _cartridge) = 0;
 		virtual void InitMemoryState() = 0;
@@ -65,8 +71,6 @@ namespace Emulation {
 
 		virtual void RequestInterrupts(const u8& isr_flags) = 0;
 
-		static std::weak_ptr<BaseMEM> m_Instance;
-
 		std::vector<u8> romData;
 
 		std::vector<memory_type_tables> memoryTables;
@@ -25,13 +25,17 @@
 using namespace std::chrono;
 
 namespace Emulation {
+	class Machine;
+
 	class BaseMMU {
 	public:
-		// get/reset instance
-		static std::shared_ptr<BaseMMU> s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge);
-		static std::shared_ptr<BaseMMU> s_GetInstance();
-		static void s_ResetInstance();
-		virtual void Init() = 0;
+		// creates the console specific component, Init wires it to the other components of its machine
+		static std::shared_ptr<BaseMMU> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+		virtual void Init(const Machine& _machine) = 0;
+
+		// run-ahead state slot, see Machine::SaveState
+		virtual void SaveState() = 0;
+		virtual void RestoreState() = 0;
 
 		// clone/assign protection
 		BaseMMU(BaseMMU const&) = delete;
@@ -53,8 +57,6 @@ namespace Emulation {
 		//virtual void ReadSave() = 0;
 		//virtual void WriteSave() = 0;
 
-		static std::weak_ptr<BaseMMU> m_Instance;
-
 		std::thread saveThread;
 		std::vector<char> saveData = std::vector<char>();
 		steady_clock::time_point saveTimePrev;
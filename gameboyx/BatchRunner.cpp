@@ -0,0 +1,307 @@
+#include "BatchRunner.h"
+
+#include "logger.h"
+
+#include <fstream>
+#include <sstream>
+#include <format>
+#include <chrono>
+#include <algorithm>
+
+using namespace std::chrono;
+
+namespace Emulation {
+	/* ***********************************************************************************************************
+		CONSTRUCTOR
+	*********************************************************************************************************** */
+	BatchRunner::BatchRunner(const int& _workers) : workerCount(std::max(_workers, 1)) {}
+
+	/* ***********************************************************************************************************
+		JOBS
+	*********************************************************************************************************** */
+	bool BatchRunner::ReadJobs(const std::string& _path, std::vector<batch_job>& _jobs) {
+		std::ifstream is(_path);
+		if (!is) {
+			LOG_ERROR("[emu] reading batch jobs from ", _path);
+			return false;
+		}
+
+		auto field = [](const std::string& _val) { return _val.compare("-") == 0 ? std::string() : _val; };
+
+		std::string line;
+		while (std::getline(is, line)) {
+			if (line.empty() || line[0] == '#') { continue; }
+
+			std::istringstream ss(line);
+			batch_job job = {};
+			std::string input_script, audio_output, profile_output;
+			if (!(ss >> job.rom_path >> job.frames)) {
+				LOG_WARN("[emu] batch job skipped: ", line);
+				continue;
+			}
+			ss >> input_script >> audio_output >> profile_output;
+			job.input_script = field(input_script);
+			job.audio_output = field(audio_output);
+			job.profile_output = field(profile_output);
+
+			_jobs.emplace_back(job);
+		}
+
+		return !_jobs.empty();
+	}
+
+	bool BatchRunner::ReadInputScript(const std::string& _path, std::vector<batch_input_event>& _inputs) {
+		_inputs.clear();
+		if (_path.empty()) { return true; }
+
+		std::ifstream is(_path);
+		if (!is) {
+			LOG_ERROR("[emu] reading input script ", _path);
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(is, line)) {
+			if (line.empty() || line[0] == '#') { continue; }
+
+			std::istringstream ss(line);
+			batch_input_event event = {};
+			std::string button;
+			int pressed = 0;
+			if (!(ss >> event.frame >> button >> pressed)) { continue; }
+
+			event.button = SDL_GameControllerGetButtonFromString(button.c_str());
+			event.pressed = pressed != 0;
+			if (event.button == SDL_CONTROLLER_BUTTON_INVALID) {
+				LOG_WARN("[emu] unknown button in input script: ", button);
+				continue;
+			}
+
+			_inputs.emplace_back(event);
+		}
+
+		std::stable_sort(_inputs.begin(), _inputs.end(), [](const batch_input_event& _a, const batch_input_event& _b) { return _a.frame < _b.frame; });
+		return true;
+	}
+
+	// FNV-1a over the visible pixels, independent of the pitch
+	u64 BatchRunner::HashFrame(const gpu_frame& _frame) {
+		u64 hash = 0xcbf29ce484222325;
+		int line_size = _frame.width * BaseGPU::GetPixelSize(_frame.format);
+		for (int y = 0; y < _frame.height; y++) {
+			const u8* line = &_frame.image_data[y * _frame.pitch];
+			for (int x = 0; x < line_size; x++) {
+				hash = (hash ^ line[x]) * 0x100000001b3;
+			}
+		}
+		return hash;
+	}
+
+	/* ***********************************************************************************************************
+		RUN
+	*********************************************************************************************************** */
+	int BatchRunner::Run(const std::vector<batch_job>& _jobs, const std::string& _summary_path) {
+		queues.clear();
+		for (int i = 0; i < workerCount; i++) {
+			queues.emplace_back(std::make_unique<worker_queue>());
+		}
+
+		for (int i = 0; i < (int)_jobs.size(); i++) {
+			queues[i % workerCount]->jobs.push_back(i);
+		}
+
+		LOG_INFO("[emu] running ", _jobs.size(), " batch jobs on ", workerCount, " workers");
+
+		int failed = 0;
+		std::thread collector = std::thread([this, &_jobs, &_summary_path, &failed]() -> void { ProcessResults(_jobs, _summary_path, failed); });
+
+		std::vector<std::thread> workers;
+		for (int i = 0; i < workerCount; i++) {
+			workers.emplace_back([this, i, &_jobs]() -> void { ProcessWorker(i, _jobs); });
+		}
+
+		for (auto& n : workers) {
+			n.join();
+		}
+		collector.join();
+
+		return failed;
+	}
+
+	// own jobs from the back, stolen ones from the front -> owner and thieves rarely meet at the same end
+	bool BatchRunner::NextJob(const int& _worker, int& _job) {
+		{
+			worker_queue& queue = *queues[_worker];
+			std::unique_lock<std::mutex> lock_jobs(queue.mutJobs);
+			if (!queue.jobs.empty()) {
+				_job = queue.jobs.back();
+				queue.jobs.pop_back();
+				return true;
+			}
+		}
+
+		for (int i = 1; i < workerCount; i++) {
+			worker_queue& queue = *queues[(_worker + i) % workerCount];
+			std::unique_lock<std::mutex> lock_jobs(queue.mutJobs);
+			if (!queue.jobs.empty()) {
+				_job = queue.jobs.front();
+				queue.jobs.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void BatchRunner::ProcessWorker(const int& _worker, const std::vector<batch_job>& _jobs) {
+		worker_context ctx = {};
+
+		int job;
+		while (NextJob(_worker, job)) {
+			batch_result result = RunJob(ctx, _jobs[job]);
+			result.job = job;
+			result.worker = _worker;
+
+			std::unique_lock<std::mutex> lock_results(mutResults);
+			results.push(result);
+			lock_results.unlock();
+			notifyResults.notify_one();
+		}
+	}
+
+	batch_result BatchRunner::RunJob(worker_context& _ctx, const batch_job& _job) {
+		batch_result result = {};
+
+		// the ROM gets read once per worker and stays in memory for the following jobs
+		auto it = _ctx.cartridges.find(_job.rom_path);
+		if (it == _ctx.cartridges.end()) {
+			auto cartridge = BaseCartridge::new_game(_job.rom_path);
+			if (cartridge == nullptr || !cartridge->ReadRom()) {
+				LOG_ERROR("[emu] batch job: reading ", _job.rom_path);
+				return result;
+			}
+			// concurrent jobs of the same ROM would share one save file
+			cartridge->persistentSave = false;
+			it = _ctx.cartridges.emplace(_job.rom_path, cartridge).first;
+		}
+		auto& cartridge = it->second;
+		result.title = cartridge->title;
+
+		if (!ReadInputScript(_job.input_script, _ctx.inputs)) {
+			return result;
+		}
+
+		auto machine = Machine::s_Create(cartridge);
+		if (machine == nullptr) {
+			return result;
+		}
+
+		// headless: the frames never get presented, the audio only goes to the optional file
+		auto graphics = machine->GetGraphics();
+		graphics->SetPixelFormat(PIXEL_FORMAT_XRGB8888);
+		graphics->SetFrameOutput(true);
+		machine->GetSound()->SetHeadless(true);
+		if (!_job.audio_output.empty()) {
+			machine->GetSound()->SetOfflineOutput(_job.audio_output);
+		}
+		machine->Init();
+
+		auto core = machine->GetCore();
+		auto control = machine->GetControl();
+		size_t next_input = 0;
+
+		// every RunCycles is one frame of the profile, written as it gets aggregated
+		auto profiler = machine->GetProfiler();
+		std::ofstream profile;
+		profiler_frame profile_frame;
+		if (!_job.profile_output.empty()) {
+			profile.open(_job.profile_output, std::ios::trunc);
+			if (!profile) {
+				LOG_WARN("[emu] batch job: profile can't be written to ", _job.profile_output);
+			} else {
+				profiler->SetEnabled(true);
+				profile << "frame";
+				for (const auto& n : PROFILE_SECTION_NAMES) {
+					profile << "\t" << n;
+				}
+				profile << "\n";
+			}
+		}
+
+		steady_clock::time_point start = steady_clock::now();
+		for (int i = 0; i < _job.frames; i++) {
+			while (next_input < _ctx.inputs.size() && _ctx.inputs[next_input].frame <= i) {
+				const batch_input_event& event = _ctx.inputs[next_input++];
+				// applied on the worker thread in script order, nothing gets published so a JOYP read latches no host state
+				if (event.pressed) {
+					control->SetKey(0, event.button);
+				} else {
+					control->ResetKey(0, event.button);
+				}
+			}
+
+			core->RunCycles();
+
+			if (profiler->IsEnabled()) {
+				profiler->EndFrame();
+				if (profiler->GetLastFrame(profile_frame)) {
+					profile << i;
+					for (const auto& n : profile_frame) {
+						profile << std::format("\t{:.1f}", n);
+					}
+					profile << "\n";
+				}
+			}
+		}
+		result.seconds = duration<float>(steady_clock::now() - start).count();
+
+		// the worker is the only reader, this is the last frame the job completed
+		if (graphics->GetFrame(_ctx.frame)) {
+			result.frame_hash = HashFrame(_ctx.frame);
+		}
+
+		result.frames = _job.frames;
+		result.success = true;
+		return result;
+	}
+
+	/* ***********************************************************************************************************
+		COLLECTOR
+	*********************************************************************************************************** */
+	void BatchRunner::ProcessResults(const std::vector<batch_job>& _jobs, const std::string& _summary_path, int& _failed) {
+		std::ofstream summary(_summary_path, std::ios::trunc);
+		if (!summary) {
+			LOG_WARN("[emu] batch summary can't be written to ", _summary_path);
+		}
+		summary << "job\tworker\ttitle\trom\tframes\tseconds\tframes/s\tframe hash\n";
+
+		steady_clock::time_point start = steady_clock::now();
+		u64 total_frames = 0;
+
+		for (size_t received = 0; received < _jobs.size(); received++) {
+			std::unique_lock<std::mutex> lock_results(mutResults);
+			notifyResults.wait(lock_results, [this]() { return !results.empty(); });
+			batch_result result = results.front();
+			results.pop();
+			lock_results.unlock();
+
+			std::string line;
+			if (result.success) {
+				float fps = result.seconds > .0f ? result.frames / result.seconds : .0f;
+				line = std::format("{}\t{}\t{}\t{}\t{}\t{:.3f}\t{:.1f}\t{:016x}", result.job, result.worker, result.title, _jobs[result.job].rom_path, result.frames, result.seconds, fps, result.frame_hash);
+				total_frames += result.frames;
+			} else {
+				line = std::format("{}\t{}\t{}\t{}\tfailed", result.job, result.worker, result.title, _jobs[result.job].rom_path);
+				_failed++;
+			}
+
+			summary << line << "\n";
+			LOG_INFO("[emu] batch ", line);
+		}
+
+		float seconds = duration<float>(steady_clock::now() - start).count();
+		std::string total = std::format("total\t{} jobs\t{} failed\t{} frames\t{:.3f}s\t{:.1f} frames/s", _jobs.size(), _failed, total_frames, seconds, seconds > .0f ? total_frames / seconds : .0f);
+		summary << total << "\n";
+		LOG_INFO("[emu] batch ", total);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Runs a list of jobs (ROM, input script, frame count, audio output) headless on a fixed pool of worker threads.
+*	Every worker has its own deque of jobs and steals from the front of the others once its own ran empty.
+*	Workers keep their cartridges (ROM data) and buffers for the following jobs, each job gets a fresh machine.
+*	Jobs never touch the save files, battery buffered RAM starts empty and stays in memory.
+*	The results go through a single collector thread which writes the summary.
+*
+*	job file, one job per line, '-' for unused fields:
+*	<rom path> <frames> [input script] [audio output] [profile output]
+*
+*	profile output: tab separated time of the subsystems per frame in microseconds (see FrameProfiler)
+*
+*	the summary lists a hash of the last frame of each job, identical runs of a ROM produce the same hash
+*
+*	input script, one event per line:
+*	<frame> <SDL game controller button name> <1: press, 0: release>
+*/
+
+#include "Machine.h"
+#include "BaseCartridge.h"
+#include "defs.h"
+
+#include <SDL.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Emulation {
+	struct batch_job {
+		std::string rom_path = "";
+		int frames = 0;
+		std::string input_script = "";
+		std::string audio_output = "";
+		std::string profile_output = "";
+	};
+
+	struct batch_result {
+		int job = 0;
+		int worker = 0;
+		bool success = false;
+		std::string title = "";
+		int frames = 0;
+		float seconds = .0f;
+		u64 frame_hash = 0;
+	};
+
+	struct batch_input_event {
+		int frame = 0;
+		SDL_GameControllerButton button = SDL_CONTROLLER_BUTTON_INVALID;
+		bool pressed = false;
+	};
+
+	class BatchRunner {
+	public:
+		explicit BatchRunner(const int& _workers);
+
+		static bool ReadJobs(const std::string& _path, std::vector<batch_job>& _jobs);
+
+		// blocks until all jobs are finished, returns the number of failed jobs
+		int Run(const std::vector<batch_job>& _jobs, const std::string& _summary_path);
+
+	private:
+		struct worker_queue {
+			std::mutex mutJobs;
+			std::deque<int> jobs;
+		};
+
+		// state owned by a single worker, reused for all of its jobs
+		struct worker_context {
+			std::unordered_map<std::string, std::shared_ptr<BaseCartridge>> cartridges;
+			std::vector<batch_input_event> inputs;
+			gpu_frame frame;
+		};
+
+		int workerCount;
+		std::vector<std::unique_ptr<worker_queue>> queues;
+
+		bool NextJob(const int& _worker, int& _job);
+		void ProcessWorker(const int& _worker, const std::vector<batch_job>& _jobs);
+		batch_result RunJob(worker_context& _ctx, const batch_job& _job);
+		static bool ReadInputScript(const std::string& _path, std::vector<batch_input_event>& _inputs);
+		static u64 HashFrame(const gpu_frame& _frame);
+
+		// collector
+		std::mutex mutResults;
+		std::condition_variable notifyResults;
+		std::queue<batch_result> results;
+
+		void ProcessResults(const std::vector<batch_job>& _jobs, const std::string& _summary_path, int& _failed);
+	};
+}
\ No newline at end of file
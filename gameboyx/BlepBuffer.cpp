@@ -0,0 +1,89 @@
+#include "BlepBuffer.h"
+
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <algorithm>
+
+namespace Emulation {
+	/* ***********************************************************************************************************
+		CONSTRUCTOR
+	*********************************************************************************************************** */
+	// the kernel is the derivative of a band limited step (blackman windowed sinc), every phase is normalized to 1
+	// so the integrated output reaches exactly the amplitude of the step
+	BlepBuffer::BlepBuffer(const int& _size) {
+		deltas = std::vector<float>(_size + BLEP_TAPS);
+
+		for (int p = 0; p < BLEP_PHASES; p++) {
+			float sum = .0f;
+
+			for (int t = 0; t < BLEP_TAPS; t++) {
+				double x = t - BLEP_TAPS / 2 - (double)p / BLEP_PHASES;
+				double w = x * 2 * std::numbers::pi / BLEP_TAPS;
+				double window = .42 + .5 * cos(w) + .08 * cos(2 * w);
+				double sinc = x == .0 ? 1. : sin(std::numbers::pi * BLEP_CUTOFF * x) / (std::numbers::pi * BLEP_CUTOFF * x);
+
+				kernel[p][t] = (float)(sinc * window);
+				sum += kernel[p][t];
+			}
+
+			for (auto& n : kernel[p]) {
+				n /= sum;
+			}
+		}
+	}
+
+	/* ***********************************************************************************************************
+		SYNTHESIS
+	*********************************************************************************************************** */
+	void BlepBuffer::SetFactor(const double& _samples_per_tick) {
+		factor = _samples_per_tick;
+	}
+
+	void BlepBuffer::AddDelta(const int& _time, const float& _delta) {
+		double pos = offset + _time * factor;
+		int index = (int)pos;
+		if (index + BLEP_TAPS > (int)deltas.size()) { return; }
+
+		const float* k = kernel[(int)((pos - index) * BLEP_PHASES)];
+		float* d = &deltas[index];
+		for (int t = 0; t < BLEP_TAPS; t++) {
+			d[t] += k[t] * _delta;
+		}
+	}
+
+	void BlepBuffer::EndBlock(const int& _time) {
+		offset += _time * factor;
+		available = (int)offset;
+	}
+
+	int BlepBuffer::SamplesAvailable() const {
+		return available;
+	}
+
+	int BlepBuffer::ReadSamples(float* _out, const int& _num, const int& _stride) {
+		int num = _num < available ? _num : available;
+
+		for (int i = 0; i < num; i++) {
+			integrator += deltas[i];
+			integrator -= integrator * BLEP_HIGHPASS;
+			_out[i * _stride] = integrator;
+		}
+
+		// keep the tails of the steps which reach into the next block
+		int remaining = (int)deltas.size() - num;
+		memmove(deltas.data(), deltas.data() + num, remaining * sizeof(float));
+		memset(deltas.data() + remaining, 0x00, num * sizeof(float));
+
+		offset -= num;
+		available -= num;
+		return num;
+	}
+
+	void BlepBuffer::Clear() {
+		std::fill(deltas.begin(), deltas.end(), .0f);
+		offset = .0;
+		available = 0;
+		integrator = .0f;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Band limited step synthesis (BLEP). Instead of sampling the channels at the output rate, every amplitude
+*	change gets recorded with the emulated tick it happened on. Each change adds a windowed sinc step
+*	(split into BLEP_PHASES sub-sample positions) to a delta buffer at the output rate, which gets
+*	integrated once per block. The output is free of aliasing and only depends on the emulated time.
+*/
+
+#include <vector>
+
+#include "defs.h"
+
+#define BLEP_TAPS                       16
+#define BLEP_PHASES                     32
+#define BLEP_CUTOFF                     .9f                 // relative to the nyquist frequency
+#define BLEP_HIGHPASS                   (1.f / 4096)        // leak of the integrator, removes DC like the DMG output capacitor
+
+namespace Emulation {
+	class BlepBuffer {
+	public:
+		BlepBuffer(const int& _size);
+
+		// output samples per emulated tick, applies to the following block
+		void SetFactor(const double& _samples_per_tick);
+
+		// _time: ticks since the start of the current block
+		void AddDelta(const int& _time, const float& _delta);
+		// closes the block, the samples up to _time can be read afterwards
+		void EndBlock(const int& _time);
+
+		int SamplesAvailable() const;
+		// writes every _stride-th element of _out, returns the number of samples read
+		int ReadSamples(float* _out, const int& _num, const int& _stride);
+
+		void Clear();
+
+	private:
+		std::vector<float> deltas;
+		float kernel[BLEP_PHASES][BLEP_TAPS] = {};
+
+		double factor = .0;
+		double offset = .0;			// sub-sample position of the block start
+		int available = 0;
+		float integrator = .0f;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "FrameProfiler.h"
+
+#include <algorithm>
+
+using namespace std::chrono;
+
+namespace Emulation {
+	/* ***********************************************************************************************************
+		CONSTRUCTOR
+	*********************************************************************************************************** */
+	FrameProfiler::FrameProfiler() : id(s_NextId.fetch_add(1)) {
+		for (auto& n : flushed) {
+			n.store(0);
+		}
+		for (auto& n : ring) {
+			for (auto& m : n) {
+				m.store(.0f);
+			}
+		}
+
+		ticksPrev = PROFILER_TICKS();
+		timePrev = steady_clock::now();
+	}
+
+	void FrameProfiler::SetEnabled(const bool& _enabled) {
+		enabled.store(_enabled, std::memory_order_relaxed);
+	}
+
+	/* ***********************************************************************************************************
+		AGGREGATION
+	*********************************************************************************************************** */
+	void FrameProfiler::Flush() {
+		profiler_accumulator& accumulator = GetAccumulator();
+		for (int i = 0; i < PROFILE_SECTIONS_NUM; i++) {
+			i64& ticks = accumulator.ticks[i];
+			if (ticks != 0) {
+				flushed[i].fetch_add(ticks, std::memory_order_relaxed);
+				ticks = 0;
+			}
+		}
+	}
+
+	void FrameProfiler::EndFrame() {
+		u64 ticks_cur = PROFILER_TICKS();
+		steady_clock::time_point time_cur = steady_clock::now();
+		double us = duration<double, std::micro>(time_cur - timePrev).count();
+		if (us > .0 && ticks_cur > ticksPrev) {
+			double ticks_per_us = (ticks_cur - ticksPrev) / us;
+			ticksPerUs = ticksPerUs > .0 ? ticksPerUs * .9 + ticks_per_us * .1 : ticks_per_us;
+		}
+		ticksPrev = ticks_cur;
+		timePrev = time_cur;
+
+		profiler_accumulator& accumulator = GetAccumulator();
+		if (!IsEnabled()) {
+			accumulator.ticks = {};
+			for (auto& n : flushed) {
+				n.store(0, std::memory_order_relaxed);
+			}
+			return;
+		}
+
+		u64 frame = framesWritten.load(std::memory_order_relaxed);
+		auto& entry = ring[frame % PROFILER_FRAMES];
+		for (int i = 0; i < PROFILE_SECTIONS_NUM; i++) {
+			i64 ticks = accumulator.ticks[i] + flushed[i].exchange(0, std::memory_order_relaxed);
+			accumulator.ticks[i] = 0;
+			entry[i].store(ticksPerUs > .0 ? (float)(ticks / ticksPerUs) : .0f, std::memory_order_relaxed);
+		}
+		framesWritten.store(frame + 1, std::memory_order_release);
+	}
+
+	/* ***********************************************************************************************************
+		ACCESS
+	*********************************************************************************************************** */
+	bool FrameProfiler::GetLastFrame(profiler_frame& _frame) const {
+		u64 frames = framesWritten.load(std::memory_order_acquire);
+		if (frames == 0) { return false; }
+
+		const auto& entry = ring[(frames - 1) % PROFILER_FRAMES];
+		for (int i = 0; i < PROFILE_SECTIONS_NUM; i++) {
+			_frame[i] = entry[i].load(std::memory_order_relaxed);
+		}
+		return true;
+	}
+
+	void FrameProfiler::GetFrames(std::vector<profiler_frame>& _frames) const {
+		u64 frames = framesWritten.load(std::memory_order_acquire);
+		u64 num = std::min(frames, (u64)PROFILER_FRAMES - 1);
+
+		_frames.resize(num);
+		for (u64 i = 0; i < num; i++) {
+			const auto& entry = ring[(frames - num + i) % PROFILER_FRAMES];
+			for (int j = 0; j < PROFILE_SECTIONS_NUM; j++) {
+				_frames[i][j] = entry[j].load(std::memory_order_relaxed);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Per frame time of the emulated subsystems. ProfileScope measures the time of its scope with the time stamp
+*	counter and adds it to an accumulator of the calling thread, nested scopes get subtracted from the enclosing
+*	one (every section only holds its own time). The accumulator belongs to one profiler at a time, a thread which
+*	moves on to another machine (e.g. batch jobs) starts over with an empty one. The thread driving the frames aggregates its accumulator and the
+*	ones handed over by other threads (render thread) into a fixed ring once per frame. The ring gets read without
+*	locks, the reader skips the entry which may be written at the same time.
+*	Disabled scopes only cost a relaxed load, the profiler gets enabled while its data is being shown.
+*/
+
+#include "defs.h"
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_TICKS()                __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_TICKS()                __rdtsc()
+#else
+#define PROFILER_TICKS()                (u64)std::chrono::steady_clock::now().time_since_epoch().count()
+#endif
+
+#define PROFILER_FRAMES                 128                 // ring entries, the newest PROFILER_FRAMES - 1 can be read
+
+namespace Emulation {
+	enum profiler_sections {
+		PROFILE_CPU,
+		PROFILE_PPU_RENDER,
+		PROFILE_PPU_MODES,
+		PROFILE_APU,
+		PROFILE_DMA,
+		PROFILE_PACING,
+		PROFILE_SECTIONS_NUM
+	};
+
+	inline const std::array<const char*, PROFILE_SECTIONS_NUM> PROFILE_SECTION_NAMES = {
+		"CPU",
+		"PPU rasterization",
+		"PPU modes",
+		"APU",
+		"DMA",
+		"Pacing"
+	};
+
+	// microseconds per section
+	using profiler_frame = std::array<float, PROFILE_SECTIONS_NUM>;
+
+	struct profiler_accumulator {
+		std::array<i64, PROFILE_SECTIONS_NUM> ticks = {};
+		int current = -1;								// innermost open scope
+		u64 owner = 0;									// id of the profiler the ticks belong to
+	};
+
+	inline thread_local profiler_accumulator t_ProfilerAccumulator;
+
+	class FrameProfiler {
+	public:
+		FrameProfiler();
+
+		void SetEnabled(const bool& _enabled);
+		bool IsEnabled() const {
+			return enabled.load(std::memory_order_relaxed);
+		}
+
+		// threads other than the one calling EndFrame hand their accumulated time over
+		void Flush();
+		void EndFrame();
+
+		// newest last, returns false when no frame got aggregated yet
+		bool GetLastFrame(profiler_frame& _frame) const;
+		void GetFrames(std::vector<profiler_frame>& _frames) const;
+
+		// accumulator of the calling thread, emptied when it last held the time of another profiler
+		profiler_accumulator& GetAccumulator() const {
+			profiler_accumulator& accumulator = t_ProfilerAccumulator;
+			if (accumulator.owner != id) {
+				accumulator = profiler_accumulator();
+				accumulator.owner = id;
+			}
+			return accumulator;
+		}
+
+	private:
+		// unique per instance, unlike the address it never gets reused by the profiler of a later machine
+		static inline std::atomic<u64> s_NextId = 1;
+		u64 id = 0;
+
+		alignas(64) std::atomic<bool> enabled = false;
+		alignas(64) std::array<std::atomic<i64>, PROFILE_SECTIONS_NUM> flushed;
+
+		std::array<std::array<std::atomic<float>, PROFILE_SECTIONS_NUM>, PROFILER_FRAMES> ring;
+		alignas(64) std::atomic<u64> framesWritten = 0;
+
+		// the tick rate gets calibrated against the steady clock every frame
+		u64 ticksPrev = 0;
+		std::chrono::steady_clock::time_point timePrev;
+		double ticksPerUs = .0;
+	};
+
+	class ProfileScope {
+	public:
+		ProfileScope(const FrameProfiler* _profiler, const profiler_sections& _section) {
+			if (_profiler == nullptr || !_profiler->IsEnabled()) { return; }
+
+			accumulator = &_profiler->GetAccumulator();
+			section = _section;
+			parent = accumulator->current;
+			accumulator->current = section;
+			start = PROFILER_TICKS();
+		}
+
+		~ProfileScope() {
+			if (section < 0) { return; }
+
+			i64 ticks = (i64)(PROFILER_TICKS() - start);
+			accumulator->ticks[section] += ticks;
+			if (parent >= 0) {
+				accumulator->ticks[parent] -= ticks;
+			}
+			accumulator->current = parent;
+		}
+
+		// clone/assign protection
+		ProfileScope(ProfileScope const&) = delete;
+		ProfileScope(ProfileScope&&) = delete;
+		ProfileScope& operator=(ProfileScope const&) = delete;
+		ProfileScope& operator=(ProfileScope&&) = delete;
+
+	private:
+		profiler_accumulator* accumulator = nullptr;
+		int section = -1;
+		int parent = -1;
+		u64 start = 0;
+	};
+}
\ No newline at end of file
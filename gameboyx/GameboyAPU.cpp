@@ -1,7 +1,10 @@
 #include "GameboyAPU.h"
+#include "Machine.h"
 #include "gameboy_defines.h"
 
-#include <mutex>
+#include <cstring>
+#include <format>
+#include <algorithm>
 
 using namespace std;
 
@@ -23,14 +26,45 @@ namespace Emulation {
 		GameboyAPU::GameboyAPU(std::shared_ptr<BaseCartridge> _cartridge) : BaseAPU() {}
 
 		GameboyAPU::~GameboyAPU() {
-			Backend::HardwareMgr::StopAudioBackend();
+			if (audioBackend) {
+				Backend::HardwareMgr::StopAudioBackend();
+			}
 		}
 
-		void GameboyAPU::Init() {
-			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(BaseMEM::s_GetInstance());
+		void GameboyAPU::Init(const Machine& _machine) {
+			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(_machine.GetMem());
+			profiler = _machine.GetProfiler().get();
 			soundCtx = m_MemInstance.lock()->GetSoundContext();
 
+			// offline rendering runs at a fixed sampling rate independent of the audio device, the output then only
+			// depends on the emulated time
+			if (headless || !offlineOutput.empty()) {
+				virtualChannels = APU_OFFLINE_CHANNELS;
+				m_physSamplingRate = APU_OFFLINE_SAMPLING_RATE;
+				UpdateTicksPerSample();
+				for (auto& n : blepBuffers) {
+					n.SetFactor(1. / ticksPerSample.load());
+				}
+
+				if (!offlineOutput.empty()) {
+					audioWriter = std::make_unique<AudioWriter>(offlineOutput, virtualChannels, m_physSamplingRate);
+					if (audioWriter->IsOpen()) {
+						SetupOutputRouting();
+						return;
+					}
+					audioWriter.reset();
+				}
+
+				if (headless) {
+					synthesisBypass.store(true);
+					return;
+				}
+			}
+
+			// the audio backend places the virtual speakers itself and doesn't report the layout of the device,
+			// it always gets the quad layout
 			virtualChannels = APU_CHANNELS_NUM;
+			SetupOutputRouting();
 
 			Backend::virtual_audio_information virt_audio_info = {};
 			virt_audio_info.channels = virtualChannels;
@@ -39,155 +73,378 @@ namespace Emulation {
 				};
 			virt_audio_info.sr_update_callback = [this](int const& _sampling_rate) -> void {
 				m_physSamplingRate = _sampling_rate;
-				ticksPerSample.store((int)((BASE_CLOCK_CPU / m_physSamplingRate) + .5f));
+				UpdateTicksPerSample();
 				};
 
 			m_physSamplingRate = Backend::HardwareMgr::GetAudioSettings().sampling_rate;
-			ticksPerSample.store((int)((BASE_CLOCK_CPU / m_physSamplingRate) + .5f));
+			UpdateTicksPerSample();
+			for (auto& n : blepBuffers) {
+				n.SetFactor(1. / ticksPerSample.load());
+			}
 
 			Backend::HardwareMgr::StartAudioBackend(virt_audio_info);
+			audioBackend = true;
+		}
+
+		// output layout gets decided once, the mixer only applies the resulting gains per block,
+		// channel 1 and 2 on the front, 3 and 4 on the rear speakers
+		void GameboyAPU::SetupOutputRouting() {
+			// stereo sums front and rear -> same headroom as a single quad speaker
+			outputGain = (float)virtualChannels / APU_CHANNELS_NUM;
+
+			for (int i = 0; i < 4; i++) {
+				bool front = i < 2;
+
+				if (virtualChannels == 2) {
+					// left, right
+					outputRouting[i][0] = 1;
+					outputRouting[i][1] = 0;
+				} else if (audioWriter) {
+					// WAV speaker order: front left, front right, back left, back right
+					outputRouting[i][0] = front ? 1 : 3;
+					outputRouting[i][1] = front ? 0 : 2;
+				} else {
+					// virtual channel order of the audio backend: front right, rear right, rear left, front left
+					outputRouting[i][0] = front ? 0 : 1;
+					outputRouting[i][1] = front ? 3 : 2;
+				}
+			}
+		}
+
+		void GameboyAPU::UpdateTicksPerSample() {
+			ticksPerSample.store((float)(BASE_CLOCK_CPU / m_physSamplingRate) * resamplingRatio.load());
+		}
+
+		float GameboyAPU::GetBufferFill() const {
+			return (float)sampleRing.Size() / sampleRing.Capacity();
+		}
+
+		// > 1 stretches the emulated time per output sample -> less samples get generated
+		void GameboyAPU::SetResamplingRatio(const float& _ratio) {
+			resamplingRatio.store(_ratio);
+			UpdateTicksPerSample();
+		}
+
+		void GameboyAPU::SaveState() {
+			savedState.frame_sequencer_step = frameSequencerStep;
+			std::copy(chInfos, chInfos + 4, savedState.ch_infos);
+		}
+
+		// the levels keep their current value, they describe what already went to the output
+		void GameboyAPU::RestoreState() {
+			frameSequencerStep = savedState.frame_sequencer_step;
+			for (int i = 0; i < 4; i++) {
+				float level = chInfos[i].level;
+				chInfos[i] = savedState.ch_infos[i];
+				chInfos[i].level = level;
+			}
+			// the restored registers apply with the next generated samples
+			outputsStale = true;
+		}
+
+		void GameboyAPU::FinishOfflineOutput() {
+			if (!audioWriter) { return; }
+
+			audioWriter.reset();
+			synthesisBypass.store(true);
+		}
+
+		void GameboyAPU::SetSynthesisBypass(const bool& _bypass) {
+			synthesisBypass.store(_bypass);
+		}
+
+		void GameboyAPU::GetHardwareInfo(std::vector<data_entry>& _hardware_info) const {
+			_hardware_info.emplace_back("Audio buffer", std::format("{:.1f}%", GetBufferFill() * 100.f));
+			_hardware_info.emplace_back("Audio ratio", std::format("{:+.3f}%", (resamplingRatio.load() - 1.f) * 100.f));
+			_hardware_info.emplace_back("Audio underruns", std::format("{:d}", underruns.load()));
+			_hardware_info.emplace_back("Audio blocks dropped", std::format("{:d}", droppedBlocks.load()));
+			_hardware_info.emplace_back("Audio synthesis", synthesisBypass.load() ? "bypassed" : (synthesisSilent.load() ? "silent" : "active"));
+			if (audioWriter) {
+				_hardware_info.emplace_back("Audio rendered", std::format("{:.1f}s", audioWriter->GetSecondsWritten()));
+			}
 		}
 
 		/* *************************************************************************************************
 			APU PROCESSING -> DIRECTLY ATTACHED TO THE CPUS INTERNAL TIMERS
+			called on every falling edge of the DIV-APU bit (512 Hz), each call advances the frame sequencer
+			by one step and only runs the units which are due on that step:
+			step	0	1	2	3	4	5	6	7
+			length	x		x		x		x
+			sweep			x				x
+			envelope								x
 		************************************************************************************************* */
 		void GameboyAPU::ProcessAPU(const int& _ticks) {
-			if (soundCtx->apuEnable) {
-				for (int i = 0; i < _ticks; i++) {
-					envelopeSweepCounter++;
-					soundLengthCounter++;
-					ch1SamplingRateCounter++;
-
-					bool ch_enable[4] = {
-						soundCtx->ch_ctxs[0].enable.load(),
-						soundCtx->ch_ctxs[1].enable.load(),
-						soundCtx->ch_ctxs[2].enable.load(),
-						soundCtx->ch_ctxs[3].enable.load()
-					};
-
-					if (envelopeSweepCounter == ENVELOPE_SWEEP_TICK_RATE) {
-						envelopeSweepCounter = 0;
-
-						for (int j = 0; j < 4; j++) {
-							if (j != 2 && ch_enable[j]) {
-								envelopeSweep(&chInfos[j], &soundCtx->ch_ctxs[j]);
-							}
-						}
-					}
+			if (!soundCtx->apuEnable) { return; }
+			ProfileScope profile_scope(profiler, PROFILE_APU);
 
-					if (soundLengthCounter == SOUND_LENGTH_TICK_RATE) {
-						soundLengthCounter = 0;
+			for (int i = 0; i < _ticks; i++) {
+				u8 step = 1 << frameSequencerStep;
+				frameSequencerStep = (frameSequencerStep + 1) & (APU_FRAME_SEQUENCER_STEPS - 1);
 
-						for (int j = 0; j < 4; j++) {
-							if (ch_enable[j]) {
-								tickLengthTimer(&chInfos[j], &soundCtx->ch_ctxs[j]);
-							}
+				if (step & APU_FRAME_SEQUENCER_LENGTH) {
+					for (int j = 0; j < 4; j++) {
+						if (soundCtx->ch_ctxs[j].enable) {
+							tickLengthTimer(&chInfos[j], &soundCtx->ch_ctxs[j]);
 						}
 					}
+				}
 
-					if (ch1SamplingRateCounter == CH1_FREQU_SWEEP_RATE) {
-						ch1SamplingRateCounter = 0;
+				if (step & APU_FRAME_SEQUENCER_SWEEP) {
+					auto* ch_ctx = &soundCtx->ch_ctxs[0];
+					if (ch_ctx->enable) {
+						// frequency sweep
+						periodSweep(&chInfos[0], ch_ctx);
+					}
+				}
 
-						auto* ch_ctx = &soundCtx->ch_ctxs[0];
-						if (ch_ctx->enable.load()) {
-							// frequency sweep
-							periodSweep(&chInfos[0], ch_ctx);
+				if (step & APU_FRAME_SEQUENCER_ENVELOPE) {
+					for (int j = 0; j < 4; j++) {
+						if (j != 2 && soundCtx->ch_ctxs[j].enable) {
+							envelopeSweep(&chInfos[j], &soundCtx->ch_ctxs[j]);
 						}
 					}
 				}
-
-				TickLFSR(_ticks, &chInfos[3], &soundCtx->ch_ctxs[3]);
 			}
+
+			// volume and enable changes of envelope, length timer and sweep
+			UpdateChannelOutputs();
 		}
 
 		/* *************************************************************************************************
 			GENERATE NEW SAMPLES DURING INSTRUCTION EXECUTION, AS SOME GAMES RELY ON THIS
+			the channels run on the emulated ticks and record every change of their output level with the
+			tick it happened on (band limited steps), once per block the buffers get integrated and the
+			resulting frames pushed to the ring buffer. Register and wave RAM writes therefore take effect
+			at the exact tick.
 		************************************************************************************************* */
 		void GameboyAPU::GenerateSamples(const int& _ticks) {
-			SampleWaveRam(_ticks, &chInfos[2], &soundCtx->ch_ctxs[2]);
+			// length counters, sweep and envelope run in ProcessAPU, NR52 stays accurate without any synthesis
+			if (synthesisBypass.load(std::memory_order_relaxed)) {
+				outputsStale = true;
+				return;
+			}
+			ProfileScope profile_scope(profiler, PROFILE_APU);
+
+			// nothing audible: the channels fade to zero once and keep their phase, only the block timing runs on
+			// so the audio device still gets (silent) frames
+			if (!IsAudible()) {
+				if (!synthesisSilent.load(std::memory_order_relaxed)) {
+					for (int i = 0; i < 4; i++) {
+						if (chInfos[i].level != .0f) {
+							blepBuffers[i].AddDelta(blockTicks, -chInfos[i].level);
+							chInfos[i].level = .0f;
+						}
+					}
+					synthesisSilent.store(true, std::memory_order_relaxed);
+				}
+
+				blockTicks += _ticks;
+				if (blockTicks >= APU_BLOCK_TICKS) {
+					EndBlock();
+				}
+				return;
+			}
+			if (synthesisSilent.load(std::memory_order_relaxed) || outputsStale) {
+				// the levels got faded out or missed changes, pick up the current ones again
+				synthesisSilent.store(false, std::memory_order_relaxed);
+				outputsStale = false;
+				for (int i = 0; i < 4; i++) {
+					UpdateChannelOutput(i, blockTicks);
+				}
+			}
+
+			for (int i = 0; i < 4; i++) {
+				if (soundCtx->ch_ctxs[i].enable) {
+					TickChannel(i, _ticks);
+				}
+			}
+
+			blockTicks += _ticks;
+			if (blockTicks >= APU_BLOCK_TICKS) {
+				EndBlock();
+			}
+		}
+
+		// output changes outside of the channel steps, only recorded while samples get synthesized
+		void GameboyAPU::UpdateChannelOutputs() {
+			if (synthesisBypass.load(std::memory_order_relaxed) || synthesisSilent.load(std::memory_order_relaxed)) { return; }
+
+			for (int i = 0; i < 4; i++) {
+				UpdateChannelOutput(i, blockTicks);
+			}
+		}
+
+		bool GameboyAPU::IsAudible() const {
+			if (!soundCtx->apuEnable) { return false; }
+
+			for (const auto& n : soundCtx->ch_ctxs) {
+				if (n.enable && (n.right || n.left)) {
+					return true;
+				}
+			}
+			return false;
 		}
 
 		/* *************************************************************************************************
-			GENERATE NEW SAMPLES BASED ON CURRENT WAVE RAM STATE
+			STEPS THE CHANNELS WAVEFORM
 			some games require fast changes in volume and RAM state for more complex wave forms to work.
 			One such example is pokemon yellow, here is a good breakdown of how the "pikachu" sound was
 			achieved and why this is necessary: https://www.youtube.com/watch?v=fooSxCuWvZ4&t=421s
 		************************************************************************************************* */
-		void GameboyAPU::SampleWaveRam(const int& _ticks, channel_info* _ch_info, channel_context* _ch_ctx) {
-			if (_ch_ctx->enable.load() && !_ch_ctx->use_current_state) {
-				auto* wave_ctx = static_cast<ch_ext_waveram*>(_ch_ctx->exts[WAVE_RAM].get());
-
-				int ticks_per_sample = (int)(BASE_CLOCK_CPU / _ch_ctx->sampling_rate.load());
-				float volume = _ch_ctx->volume.load();
+		void GameboyAPU::TickChannel(const int& _ch, const int& _ticks) {
+			channel_context* ch_ctx = &soundCtx->ch_ctxs[_ch];
+			channel_info& ch_info = chInfos[_ch];
+
+			int ticks_per_step;
+			switch (_ch) {
+			case 0:
+			case 1:
+				ticks_per_step = (CH_1_2_3_PERIOD_FLIP - ch_ctx->period) * CH_1_2_TICKS_PER_STEP;
+				break;
+			case 2:
+				ticks_per_step = (CH_1_2_3_PERIOD_FLIP - ch_ctx->period) * CH_3_TICKS_PER_STEP;
+				break;
+			default:
+				ticks_per_step = ch_ctx->lfsr.clock_ticks;
+				break;
+			}
 
-				wave_ctx->sample_tick_count += _ticks;
-				for (; wave_ctx->sample_tick_count >= ticks_per_sample; wave_ctx->sample_tick_count -= ticks_per_sample) {
-					++_ch_info->sample_count %= 32;
+			ch_info.step_timer -= _ticks;
+			while (ch_info.step_timer <= 0) {
+				switch (_ch) {
+				case 0:
+				case 1:
+					++ch_info.sample_count %= 8;
+					break;
+				case 2:
+					++ch_info.sample_count %= 32;
+					break;
+				case 3:
+					TickLFSR(ch_ctx);
+					break;
 				}
 
-				int write_cursor = ch3WriteCursor.load();
-				int read_cursor = ch3ReadCursor.load();
+				// the step happened -step_timer ticks before the end of this call
+				UpdateChannelOutput(_ch, blockTicks + _ticks + ch_info.step_timer);
+				ch_info.step_timer += ticks_per_step;
+			}
+		}
 
-				int ticks_per_sample_phys = ticksPerSample.load();
-				ch3WaveTickCounter += _ticks;
-				for (; ch3WaveTickCounter >= ticks_per_sample_phys; ch3WaveTickCounter -= ticks_per_sample_phys) {
-					if (write_cursor != read_cursor) {
-						ch3WaveSamples[write_cursor] = wave_ctx->wave_ram[_ch_info->sample_count] * volume;
-						++write_cursor %= CH_3_WAVERAM_BUFFER_SIZE;
-					}
+		/* *************************************************************************************************
+			PROCESSES THE LFSR -> BASICALLY A PSEUDO RANDOM NUMBER GENERATOR (NOISE)
+		************************************************************************************************* */
+		void GameboyAPU::TickLFSR(channel_context* _ch_ctx) {
+			auto* lfsr_ctx = &_ch_ctx->lfsr;
+			u16& lfsr = lfsr_ctx->lfsr;
+
+			int next = (lfsr & 0x01) ^ ((lfsr >> 1) & 0x01);
+
+			switch (lfsr_ctx->lfsr_width_7bit) {
+			case true:
+				lfsr = (lfsr & ~(CH_4_LFSR_BIT_7 | CH_4_LFSR_BIT_15)) | ((next << 7) | (next << 15));
+				break;
+			case false:
+				lfsr = (lfsr & ~CH_4_LFSR_BIT_15) | (next << 15);
+				break;
+			}
+
+			lfsr >>= 1;
+		}
+
+		/* *************************************************************************************************
+			RECORDS A CHANGE OF THE CHANNELS OUTPUT LEVEL AS BAND LIMITED STEP
+		************************************************************************************************* */
+		void GameboyAPU::UpdateChannelOutput(const int& _ch, const int& _time) {
+			channel_context* ch_ctx = &soundCtx->ch_ctxs[_ch];
+			channel_info& ch_info = chInfos[_ch];
+
+			float level = .0f;
+			if (ch_ctx->enable) {
+				switch (_ch) {
+				case 0:
+				case 1:
+					level = CH_1_2_PWM_SIGNALS[ch_ctx->duty_cycle_index][ch_info.sample_count];
+					break;
+				case 2:
+					level = soundCtx->wave_ram[ch_info.sample_count];
+					break;
+				case 3:
+					level = ch_ctx->lfsr.lfsr & 0x0001 ? 1.f : -1.f;
+					break;
 				}
 
-				ch3WriteCursor.store(write_cursor);
+				level *= ch_ctx->volume * .05f;
+			}
+
+			if (level != ch_info.level) {
+				blepBuffers[_ch].AddDelta(_time, level - ch_info.level);
+				ch_info.level = level;
 			}
 		}
 
 		/* *************************************************************************************************
-			PROCESSES AND SAMPLES THE LFSR -> BASICALLY A PSEUDO RANDOM NUMBER GENERATOR (NOISE)
+			INTEGRATES THE BLOCK, MIXES IT AND HANDS THE FRAMES TO THE AUDIO THREAD
+			panning and master volume apply per block, the loops work on contiguous blocks of floats and
+			get vectorized by the compiler
 		************************************************************************************************* */
-		void GameboyAPU::TickLFSR(const int& _ticks, channel_info* _ch_info, channel_context* _ch_ctx) {
-			if (_ch_ctx->enable.load()) {
-				auto* lfsr_ctx = static_cast<ch_ext_lfsr*>(_ch_ctx->exts[LFSR].get());
-				for (int i = 0; i < _ticks * CH_4_LFSR_TICKS_PER_APU_TICK; i++) {
-					ch4LFSRTickCounter += lfsr_ctx->lfsr_step;
-
-					if (ch4LFSRTickCounter > 1.f) {
-						ch4LFSRTickCounter -= 1.f;
-
-						// tick LFSR
-						u16& lfsr = lfsr_ctx->lfsr;
-						int next = (lfsr & 0x01) ^ ((lfsr >> 1) & 0x01);
-
-						switch (lfsr_ctx->lfsr_width_7bit) {
-						case true:
-							lfsr = (lfsr & ~(CH_4_LFSR_BIT_7 | CH_4_LFSR_BIT_15)) | ((next << 7) | (next << 15));
-							break;
-						case false:
-							lfsr = (lfsr & ~CH_4_LFSR_BIT_15) | (next << 15);
-							break;
-						}
+		void GameboyAPU::EndBlock() {
+			for (auto& n : blepBuffers) {
+				n.EndBlock(blockTicks);
+			}
+			blockTicks = 0;
 
-						lfsr >>= 1;
+			int num = blepBuffers[0].SamplesAvailable();
+			for (int i = 0; i < 4; i++) {
+				blepBuffers[i].ReadSamples(&channelBlocks[i * APU_BLOCK_SAMPLES_MAX], num, 1);
+			}
 
-						int write_cursor = ch4WriteCursor.load();
+			// gain of each channel on each output
+			float gains[APU_CHANNELS_NUM][4] = {};
+			float master[2] = {
+				soundCtx->masterVolumeRight ? outputGain : .0f,
+				soundCtx->masterVolumeLeft ? outputGain : .0f
+			};
+			for (int i = 0; i < 4; i++) {
+				const channel_context& ch_ctx = soundCtx->ch_ctxs[i];
+				float amp = ch_ctx.right && ch_ctx.left ? 1.f : 2.f;
 
-						if (write_cursor != ch4ReadCursor.load()) {
-							unique_lock<mutex> lock_lfsr_buffer(mutLFSR);
-							switch (lfsr & 0x0001) {
-							case 0x0000:
-								ch4LFSRSamples[write_cursor] = -1.f;
-								break;
-							case 0x0001:
-								ch4LFSRSamples[write_cursor] = 1.f;
-								break;
-							}
-							lock_lfsr_buffer.unlock();
+				gains[outputRouting[i][0]][i] += ch_ctx.right ? amp * master[0] : .0f;
+				gains[outputRouting[i][1]][i] += ch_ctx.left ? amp * master[1] : .0f;
+			}
 
-							++write_cursor %= CH_4_LFSR_BUFFER_SIZE;
-							ch4WriteCursor.store(write_cursor);
-						}
-					}
+			const float* ch1 = &channelBlocks[0];
+			const float* ch2 = &channelBlocks[APU_BLOCK_SAMPLES_MAX];
+			const float* ch3 = &channelBlocks[2 * APU_BLOCK_SAMPLES_MAX];
+			const float* ch4 = &channelBlocks[3 * APU_BLOCK_SAMPLES_MAX];
+			for (int i = 0; i < virtualChannels; i++) {
+				const float* g = gains[i];
+				float* dst = &mixBlocks[i * APU_BLOCK_SAMPLES_MAX];
+
+				for (int j = 0; j < num; j++) {
+					dst[j] = g[0] * ch1[j] + g[1] * ch2[j] + g[2] * ch3[j] + g[3] * ch4[j];
 				}
 			}
+
+			// interleave
+			for (int i = 0; i < virtualChannels; i++) {
+				const float* src = &mixBlocks[i * APU_BLOCK_SAMPLES_MAX];
+				for (int j = 0; j < num; j++) {
+					blockFrames[j * virtualChannels + i] = src[j];
+				}
+			}
+
+			// emulation runs ahead of the audio device -> drop the block, the offline writer never drops
+			if (audioWriter) {
+				audioWriter->Write(blockFrames.data(), num);
+			} else if (!sampleRing.Push(blockFrames.data(), num * virtualChannels)) {
+				droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// a changed sampling rate applies to the next block
+			double samples_per_tick = 1. / ticksPerSample.load(std::memory_order_relaxed);
+			for (auto& n : blepBuffers) {
+				n.SetFactor(samples_per_tick);
+			}
 		}
 
 		/* *************************************************************************************************
@@ -203,7 +460,7 @@ namespace Emulation {
 
 				_ch_info->length_counter++;
 				if (_ch_info->length_counter == CH_LENGTH_TIMER_THRESHOLD) {
-					_ch_ctx->enable.store(false);
+					_ch_ctx->enable = false;
 					m_MemInstance.lock()->GetIO(NR52_ADDR) &= ~_ch_ctx->enable_bit;
 				}
 			}
@@ -213,7 +470,7 @@ namespace Emulation {
 			ALTERS VOLUME OVER TIME (IF SET)
 		************************************************************************************************* */
 		void GameboyAPU::envelopeSweep(channel_info* _ch_info, channel_context* _ch_ctx) {
-			auto* env_ctx = static_cast<ch_ext_envelope*>(_ch_ctx->exts[ENVELOPE].get());
+			auto* env_ctx = &_ch_ctx->envelope;
 
 			if (env_ctx->envelope_pace != 0) {
 				_ch_info->envelope_sweep_counter++;
@@ -225,13 +482,13 @@ namespace Emulation {
 					case true:
 						if (env_ctx->envelope_volume < 0xF) {
 							env_ctx->envelope_volume++;
-							_ch_ctx->volume.store((float)env_ctx->envelope_volume / 0xF);
+							_ch_ctx->volume = (float)env_ctx->envelope_volume / 0xF;
 						}
 						break;
 					case false:
 						if (env_ctx->envelope_volume > 0x0) {
 							--env_ctx->envelope_volume;
-							_ch_ctx->volume.store((float)env_ctx->envelope_volume / 0xF);
+							_ch_ctx->volume = (float)env_ctx->envelope_volume / 0xF;
 						}
 						break;
 					}
@@ -243,7 +500,7 @@ namespace Emulation {
 			ALTERS THE SIGNAL FREQUENCY/TONE OVER TIME (IF SET)
 		************************************************************************************************* */
 		void GameboyAPU::periodSweep(channel_info* _ch_info, channel_context* _ch_ctx) {
-			auto* period_ctx = static_cast<ch_ext_period*>(_ch_ctx->exts[PERIOD].get());
+			auto* period_ctx = &_ch_ctx->sweep;
 
 			if (period_ctx->sweep_pace != 0) {
 				_ch_info->period_sweep_counter++;
@@ -267,7 +524,7 @@ namespace Emulation {
 
 						if (period > CH_1_2_3_PERIOD_FLIP - 1) {
 							writeback = false;
-							_ch_ctx->enable.store(false);
+							_ch_ctx->enable = false;
 							m_MemInstance.lock()->GetIO(NR52_ADDR) &= ~_ch_ctx->enable_bit;
 						}
 						break;
@@ -279,177 +536,37 @@ namespace Emulation {
 						period_ctrl = (period_ctrl & ~CH_1_2_3_PERIOD_HIGH) | ((period >> 8) & CH_1_2_3_PERIOD_HIGH);
 
 						_ch_ctx->period = period;
-						_ch_ctx->sampling_rate.store((float)(pow(2, 20) / (CH_1_2_3_PERIOD_FLIP - _ch_ctx->period)));
 					}
 				}
 			}
 		}
 
 		/* *************************************************************************************************
-			THE ACTUAL CALLBACK FOR THE AUDIO BACKEND WHICH GENERATES THE SAMPLES (DISCRETE SIGNAL) TO OUTPUT
+			THE ACTUAL CALLBACK FOR THE AUDIO BACKEND, ONLY COPIES THE MIXED FRAMES (AUDIO THREAD)
 		************************************************************************************************* */
-		// filles each vector with samples of the virtual channels and sets the virtual sampling rates for each channel (power of 2)
-		/* sample order :
-		* 1. front right
-		* 2. rear right
-		* 3. rear left
-		* 4. front left
-		*/
 		void GameboyAPU::SampleAPU(std::vector<std::complex<float>>& _data, const int& _samples) {
-			NextChunk();
-
-			bool right = soundCtx->outRightEnabled.load();
-			bool left = soundCtx->outLeftEnabled.load();
-			bool vol_right = soundCtx->masterVolumeRight.load();
-			bool vol_left = soundCtx->masterVolumeLeft.load();
-
-			channel_context* ch1_ctx = &soundCtx->ch_ctxs[0];
-			channel_context* ch2_ctx = &soundCtx->ch_ctxs[1];
-			channel_context* ch3_ctx = &soundCtx->ch_ctxs[2];
-			channel_context* ch4_ctx = &soundCtx->ch_ctxs[3];
-
-			float sample_steps[4] = {
-				ch1_ctx->sampling_rate.load() / m_physSamplingRate,
-				ch2_ctx->sampling_rate.load() / m_physSamplingRate,
-				ch3_ctx->sampling_rate.load() / m_physSamplingRate,
-				ch4_ctx->sampling_rate.load() / m_physSamplingRate
-			};
-
-			bool ch_enabled[4] = {
-				ch1_ctx->enable.load(),
-				ch2_ctx->enable.load(),
-				ch3_ctx->enable.load(),
-				ch4_ctx->enable.load()
-			};
-
-			bool ch_lr_enabled[4][2] = {
-				{ch1_ctx->right.load(), ch1_ctx->left.load()},
-				{ch2_ctx->right.load(), ch2_ctx->left.load()},
-				{ch3_ctx->right.load(), ch3_ctx->left.load()},
-				{ch4_ctx->right.load(), ch4_ctx->left.load()}
-			};
-
-			float ch_volume[4] = {
-				ch1_ctx->volume.load(),
-				ch2_ctx->volume.load(),
-				ch3_ctx->volume.load(),
-				ch4_ctx->volume.load()
-			};
-
-			float amps[4] = {
-				ch_lr_enabled[0][0] && ch_lr_enabled[0][1] ? 1.f : 2.f,
-				ch_lr_enabled[1][0] && ch_lr_enabled[1][1] ? 1.f : 2.f,
-				ch_lr_enabled[2][0] && ch_lr_enabled[2][1] ? 1.f : 2.f,
-				ch_lr_enabled[3][0] && ch_lr_enabled[3][1] ? 1.f : 2.f
-			};
+			int num = (int)sampleRing.Pop(callbackFrames.data(), std::min((size_t)_samples * virtualChannels, callbackFrames.size())) / virtualChannels;
 
-			int duty_cycle_index[2] = {
-				static_cast<ch_ext_pwm*>(ch1_ctx->exts[PWM].get())->duty_cycle_index.load(),
-				static_cast<ch_ext_pwm*>(ch2_ctx->exts[PWM].get())->duty_cycle_index.load()
-			};
-
-			bool ch3_stable_state = ch3_ctx->use_current_state;
-			ch3_ctx->use_current_state = true;
-
-			auto* wave_ctx = static_cast<ch_ext_waveram*>(ch3_ctx->exts[WAVE_RAM].get());
-
-			unique_lock<mutex> lock_wave_ram(wave_ctx->mut_wave_ram, std::defer_lock);
-			unique_lock<mutex> lock_lfsr_buffer(mutLFSR, std::defer_lock);
-
-			float samples[4] = { .0f, .0f, .0f, .0f };
-
-			for (int i = 0; i < _samples; i++) {
-				memset(samples, 0x00, sizeof(float) * 4);
-
-				for (int j = 0; j < 2; j++) {
-					if (ch_enabled[j]) {
-						chInfos[j].virt_samples += sample_steps[j];
-						while (chInfos[j].virt_samples > 1.f) {
-							chInfos[j].virt_samples -= 1.f;
-							++chInfos[j].sample_count %= 8;
-						}
-
-
-						if (ch_lr_enabled[j][0]) {
-							samples[1] += CH_1_2_PWM_SIGNALS[duty_cycle_index[j]][chInfos[j].sample_count] * ch_volume[j] * amps[j];
-						}
-						if (ch_lr_enabled[j][1]) {
-							samples[0] += CH_1_2_PWM_SIGNALS[duty_cycle_index[j]][chInfos[j].sample_count] * ch_volume[j] * amps[j];
-						}
-					}
-				}
-
-				{
-					auto& ch3Info = chInfos[2];
-
-					if (ch3_stable_state) {
-						ch3Info.virt_samples += sample_steps[2];
-						while (ch3Info.virt_samples > 1.f) {
-							ch3Info.virt_samples -= 1.f;
-							++ch3Info.sample_count %= 32;
-						}
-
-						lock_wave_ram.lock();
-						if (ch_lr_enabled[2][0]) {
-							samples[3] += wave_ctx->wave_ram[ch3Info.sample_count] * ch_volume[2] * amps[2];
-						}
-						if (ch_lr_enabled[2][1]) {
-							samples[2] += wave_ctx->wave_ram[ch3Info.sample_count] * ch_volume[2] * amps[2];
-						}
-						lock_wave_ram.unlock();
-					}
-
-					int read_cursor = ch3ReadCursor.load();
-					int write_cursor = (ch3WriteCursor.load() - 1) % CH_3_WAVERAM_BUFFER_SIZE;
-
-					if (read_cursor != write_cursor) {
-						if (!ch3_stable_state) {
-							lock_wave_ram.lock();
-							if (ch_lr_enabled[2][0]) {
-								samples[3] += ch3WaveSamples[read_cursor] * amps[2];
-							}
-							if (ch_lr_enabled[2][1]) {
-								samples[2] += ch3WaveSamples[read_cursor] * amps[2];
-							}
-							lock_wave_ram.unlock();
-						}
-
-						++read_cursor %= CH_3_WAVERAM_BUFFER_SIZE;
-						ch3ReadCursor.store(read_cursor);
-					}
-				}
+			if (num > 0) {
+				memcpy(lastFrame, &callbackFrames[(num - 1) * virtualChannels], virtualChannels * sizeof(float));
+			}
 
-				{
-					auto& ch4Info = chInfos[3];
-					lock_lfsr_buffer.lock();
-					ch4Info.virt_samples += sample_steps[3];
-
-					int read_cursor = ch4ReadCursor.load();
-					int write_cursor = (ch4WriteCursor.load() - 1) % CH_4_LFSR_BUFFER_SIZE;
-					while (ch4Info.virt_samples > 1.f) {
-						ch4Info.virt_samples -= 1.f;
-
-						// (0 - 1) % 10 = -1 % 10 and is defined as -1 * 10 + 9, where the added value is the remainder (remainder is by definition always positiv)
-						if (read_cursor != write_cursor) {
-							ch4LFSRSamples[read_cursor] = .0f;
-							++read_cursor %= CH_4_LFSR_BUFFER_SIZE;
-							ch4ReadCursor.store(read_cursor);
-						}
-					}
+			// the backend takes complex samples, only the real part is used
+			for (int i = 0; i < num * virtualChannels; i++) {
+				_data[i].real(callbackFrames[i]);
+			}
 
-					if (ch_lr_enabled[3][0]) {
-						samples[3] += ch4LFSRSamples[ch4ReadCursor] * ch_volume[3] * amps[3];
-					}
-					if (ch_lr_enabled[3][1]) {
-						samples[2] += ch4LFSRSamples[ch4ReadCursor] * ch_volume[3] * amps[3];
-					}
-					lock_lfsr_buffer.unlock();
+			// bypassed synthesis produces no frames, the output goes silent instead of holding a constant level
+			if (synthesisBypass.load(std::memory_order_relaxed)) {
+				std::fill(lastFrame, lastFrame + APU_CHANNELS_NUM, .0f);
+			} else if (num < _samples) {
+				// buffer underrun -> hold the last frame instead of clicking
+				underruns.fetch_add(1, std::memory_order_relaxed);
+			}
+			for (int i = num; i < _samples; i++) {
+				for (int j = 0; j < virtualChannels; j++) {
+					_data[i * virtualChannels + j].real(lastFrame[j]);
 				}
-
-				_data[i * virtualChannels    ].real(samples[1] * vol_right * .05f);		// front-right
-				_data[i * virtualChannels + 1].real(samples[3] * vol_right * .05f);		// rear-right
-				_data[i * virtualChannels + 2].real(samples[2] * vol_left * .05f);		// rear-left
-				_data[i * virtualChannels + 3].real(samples[0] * vol_left * .05f);		// front-left
 			}
 		}
 	}
@@ -1,6 +1,9 @@
 #pragma once
 #include "BaseAPU.h"
 #include "GameboyMEM.h"
+#include "RingBuffer.h"
+#include "BlepBuffer.h"
+#include "AudioWriter.h"
 
 #include "gameboy_defines.h"
 #include <vector>
@@ -16,10 +19,17 @@ namespace Emulation {
 			int length_counter = 0;
 			int envelope_sweep_counter = 0;
 			int sample_count = 0;
-			float virt_samples = .0f;
+			int step_timer = 0;
+			float level = .0f;					// output level, changes get recorded as band limited steps
 			int period_sweep_counter = 0;
 		};
 
+		// frame sequencer and channel timers, the output stream (levels, blocks, buffers) only ever moves forward
+		struct apu_state {
+			int frame_sequencer_step = 0;
+			channel_info ch_infos[4] = { {}, {}, {}, {} };
+		};
+
 		/* *************************************************************************************************
 			GameboyAPU CLASS
 		************************************************************************************************* */
@@ -30,44 +40,79 @@ namespace Emulation {
 			// constructor
 			GameboyAPU(std::shared_ptr<BaseCartridge> _cartridge);
 			~GameboyAPU() override;
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			// members
 			void ProcessAPU(const int& _ticks) override;
 			void GenerateSamples(const int& _ticks) override;
+			// sound register and wave RAM writes, the channel steps record their own output changes
+			void UpdateChannelOutputs();
 			void SampleAPU(std::vector<std::complex<float>>& _data, const int& _samples) override;
 
+			float GetBufferFill() const override;
+			void SetResamplingRatio(const float& _ratio) override;
+			void SetSynthesisBypass(const bool& _bypass) override;
+			void FinishOfflineOutput() override;
+			void GetHardwareInfo(std::vector<data_entry>& _hardware_info) const override;
+
 		private:
 			// base clock cpu: 4194304 Hz; sampling rate range: 22050-96000 Hz -> will never go below 44
-			alignas(64) std::atomic<int> ticksPerSample = 0;
+			alignas(64) std::atomic<float> ticksPerSample = .0f;
+			alignas(64) std::atomic<float> resamplingRatio = 1.f;
+			void UpdateTicksPerSample();
 
-			int envelopeSweepCounter = 0;
-			int soundLengthCounter = 0;
-			int ch1SamplingRateCounter = 0;
+			// buffer statistics
+			alignas(64) std::atomic<int> underruns = 0;			// audio thread had no frames
+			alignas(64) std::atomic<int> droppedBlocks = 0;		// emulation thread found the buffer full
+
+			// synthesis bypass: requested from outside or nothing audible (APU off, no channel routed to an output)
+			alignas(64) std::atomic<bool> synthesisBypass = false;
+			alignas(64) std::atomic<bool> synthesisSilent = false;
+			// output changes got missed while bypassed, emulation thread only
+			bool outputsStale = false;
+			bool IsAudible() const;
+
+			int frameSequencerStep = 0;
 
 			int virtualChannels = 0;
 			channel_info chInfos[4] = { {}, {}, {}, {} };
 
+			apu_state savedState = apu_state();
+
 			void tickLengthTimer(channel_info* _ch_info, channel_context* _ch_ctx);
 			void envelopeSweep(channel_info* _ch_info, channel_context* _ch_ctx);
 			void periodSweep(channel_info* _ch_info, channel_context* _ch_ctx);
 
-			// Channel 4 specific (probably move to struct, too)
-			float ch4LFSRTickCounter = 0;
-			std::mutex mutLFSR;
-			std::vector<float> ch4LFSRSamples = std::vector<float>(CH_4_LFSR_BUFFER_SIZE);
-			alignas(64) std::atomic<int> ch4WriteCursor = 1;			// always points to the next sample to write
-			alignas(64) std::atomic<int> ch4ReadCursor = 0;				// always points to the current sample to read
+			// output frames get synthesized on the emulation thread, the audio callback only copies them out
+			RingBuffer<float> sampleRing = RingBuffer<float>(APU_SAMPLE_RING_SIZE);
+			float lastFrame[APU_CHANNELS_NUM] = {};		// audio thread, repeated on buffer underrun
+			std::vector<float> callbackFrames = std::vector<float>(APU_SAMPLE_RING_SIZE);	// audio thread
 
-			void TickLFSR(const int& _ticks, channel_info* _ch_info, channel_context* _ch_ctx);
+			BlepBuffer blepBuffers[4] = {
+				BlepBuffer(APU_BLOCK_SAMPLES_MAX),
+				BlepBuffer(APU_BLOCK_SAMPLES_MAX),
+				BlepBuffer(APU_BLOCK_SAMPLES_MAX),
+				BlepBuffer(APU_BLOCK_SAMPLES_MAX)
+			};
+			// planar channel and output blocks, interleaved frames
+			std::vector<float> channelBlocks = std::vector<float>(APU_BLOCK_SAMPLES_MAX * 4);
+			std::vector<float> mixBlocks = std::vector<float>(APU_BLOCK_SAMPLES_MAX * APU_CHANNELS_NUM);
+			std::vector<float> blockFrames = std::vector<float>(APU_BLOCK_SAMPLES_MAX * APU_CHANNELS_NUM);
+			int outputRouting[4][2] = {};				// right, left output of each channel
+			float outputGain = 1.f;
+			void SetupOutputRouting();
+			int blockTicks = 0;
 
-			int ch3WaveTickCounter = 0;
-			std::mutex mutWaveRam;
-			std::vector<float> ch3WaveSamples = std::vector<float>(CH_3_WAVERAM_BUFFER_SIZE);
-			alignas(64) std::atomic<int> ch3WriteCursor = 1;			// always points to the next sample to write
-			alignas(64) std::atomic<int> ch3ReadCursor = 0;				// always points to the current sample to read
+			// offline rendering, replaces the audio backend and the sample ring
+			std::unique_ptr<AudioWriter> audioWriter;
+			bool audioBackend = false;
 
-			void SampleWaveRam(const int& _ticks, channel_info* _ch_info, channel_context* _ch_ctx);
+			void TickChannel(const int& _ch, const int& _ticks);
+			void TickLFSR(channel_context* _ch_ctx);
+			void UpdateChannelOutput(const int& _ch, const int& _time);
+			void EndBlock();
 
 			std::weak_ptr<GameboyMEM> m_MemInstance;
 			sound_context* soundCtx = nullptr;
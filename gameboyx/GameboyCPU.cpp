@@ -3,6 +3,7 @@
 /* ***********************************************************************************************************
     INCLUDES
 *********************************************************************************************************** */
+#include "Machine.h"
 #include "gameboy_defines.h"
 #include <format>
 #include "logger.h"
@@ -87,11 +88,13 @@ namespace Emulation {
         /* ***********************************************************************************************************
             INIT CPU
         *********************************************************************************************************** */
-        void GameboyCPU::Init() {
-            m_MmuInstance = BaseMMU::s_GetInstance();
-            m_GraphicsInstance = BaseGPU::s_GetInstance();
-            m_SoundInstance = BaseAPU::s_GetInstance();
-            m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(BaseMEM::s_GetInstance());
+        void GameboyCPU::Init(const Machine& _machine) {
+            m_MmuInstance = _machine.GetMmu();
+            m_GraphicsInstance = _machine.GetGraphics();
+            m_SoundInstance = _machine.GetSound();
+            m_ControlInstance = _machine.GetControl();
+            m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(_machine.GetMem());
+            profiler = _machine.GetProfiler().get();
 
             machineCtx = m_MemInstance.lock()->GetMachineContext();
             graphics_ctx = m_MemInstance.lock()->GetGraphicsContext();
@@ -101,11 +104,37 @@ namespace Emulation {
                 InitRegisterStates();
             }
 
-            m_GraphicsInstance = BaseGPU::s_GetInstance();
-            m_SoundInstance = BaseAPU::s_GetInstance();
             ticksPerFrame = m_GraphicsInstance.lock()->GetTicksPerFrame((float)(BASE_CLOCK_CPU));
         }
 
+        /* ***********************************************************************************************************
+            STATE
+        *********************************************************************************************************** */
+        void GameboyCPU::SaveState() {
+            savedState.regs = Regs;
+            savedState.was_halted = was_halted;
+            savedState.ime_enable = imeEnable;
+            savedState.ime = ime;
+
+            savedState.tima_en_and_div_overflow_prev = timaEnAndDivOverflowPrev;
+            savedState.apu_div_bit_overflow_prev = apuDivBitOverflowPrev;
+
+            savedState.tick_counter = tickCounter;
+        }
+
+        // the callstack is debugger only, run-ahead doesn't run with the debugger
+        void GameboyCPU::RestoreState() {
+            Regs = savedState.regs;
+            was_halted = savedState.was_halted;
+            imeEnable = savedState.ime_enable;
+            ime = savedState.ime;
+
+            timaEnAndDivOverflowPrev = savedState.tima_en_and_div_overflow_prev;
+            apuDivBitOverflowPrev = savedState.apu_div_bit_overflow_prev;
+
+            tickCounter = savedState.tick_counter;
+        }
+
         // initial register states
         void GameboyCPU::InitRegisterStates() {
             Regs = registers();
@@ -135,7 +164,9 @@ namespace Emulation {
             RUN CPU
         *********************************************************************************************************** */
         void GameboyCPU::RunCycles() {
+            ProfileScope profile_scope(profiler, PROFILE_CPU);
             currentTicks = 0;
+            nextInputPoll = 0;
 
             while ((currentTicks < (ticksPerFrame * machineCtx->currentSpeed))) {
                 RunCpu();
@@ -145,7 +176,9 @@ namespace Emulation {
         }
 
         void GameboyCPU::RunCycle() {
+            ProfileScope profile_scope(profiler, PROFILE_CPU);
             currentTicks = 0;
+            nextInputPoll = 0;
 
             do {
                 RunCpu();
@@ -156,8 +189,18 @@ namespace Emulation {
         }
 
         void GameboyCPU::RunCpu() {
+            // queued host input gets applied once per scanline, the GUI thread never waits for the emulation and
+            // JOYP reads latch the newest state on their own
+            if (currentTicks >= nextInputPoll) {
+                nextInputPoll = currentTicks + PPU_DOTS_PER_SCANLINE * machineCtx->currentSpeed;
+                if (m_ControlInstance.lock()->InputPending()) {
+                    m_ControlInstance.lock()->ProcessInputs();
+                }
+            }
+
             if (machineCtx->stopped) {
-                // check button press
+                // check button press, no time passes while stopped
+                m_ControlInstance.lock()->LatchInput();
                 if (m_MemInstance.lock()->GetIO(IF_ADDR) & IRQ_JOYPAD) {
                     machineCtx->stopped = false;
                 } else {
@@ -1232,7 +1275,7 @@ namespace Emulation {
             TickTimers();
             TickTimers();
 
-            //AddToCallstack(_isr_handler);
+            if (callstackEnable) { AddToCallstack(_isr_handler); }
 
             stack_push(Regs.PC);
             Regs.PC = _isr_handler;
@@ -1987,7 +2030,7 @@ namespace Emulation {
         }
 
         void GameboyCPU::call() {
-            //AddToCallstack(data);
+            if (callstackEnable) { AddToCallstack(data); }
 
             stack_push(Regs.PC);
             Regs.PC = data;
@@ -2043,7 +2086,7 @@ namespace Emulation {
             Regs.PC = stack_pop();
             TickTimers();
 
-            //RemoveFromCallstack();
+            if (callstackEnable) { RemoveFromCallstack(); }
         }
 
         /* ***********************************************************************************************************
@@ -3564,17 +3607,24 @@ namespace Emulation {
             ACCESS HARDWARE INFO
         *********************************************************************************************************** */
         void GameboyCPU::UpdateDebugData(debug_data* _data) const {
-            _data->pc = (int)Regs.PC;
+            GetDebugIndex(_data->bank, _data->pc);
 
-            if (_data->pc < ROM_N_OFFSET) {
-                _data->bank = 0;
-            } else if (_data->pc < VRAM_N_OFFSET) {
-                _data->bank = machineCtx->rom_bank_selected + 1;
-            } else {
-                _data->bank = -1;
+            _data->callstack_size = callstackSize;
+            for (int i = 0; i < _data->callstack_size; i++) {
+                _data->callstack[i] = callstack[(callstackDepth - _data->callstack_size + i) % DEBUG_CALLSTACK_DEPTH];
             }
+        }
 
-            _data->callstack = callstack;
+        void GameboyCPU::GetDebugIndex(int& _bank, int& _pc) const {
+            _pc = (int)Regs.PC;
+
+            if (_pc < ROM_N_OFFSET) {
+                _bank = 0;
+            } else if (_pc < VRAM_N_OFFSET) {
+                _bank = machineCtx->rom_bank_selected + 1;
+            } else {
+                _bank = -1;
+            }
         }
 
         int GameboyCPU::GetPlayerCount() const {
@@ -3869,10 +3919,11 @@ namespace Emulation {
             }
         }
 
+        // called before the return address gets pushed
         void GameboyCPU::AddToCallstack(const u16& _dest) {
             callstack_data cs_data = {};
             cs_data.src_addr = Regs.PC;
-            cs_data.dest_addr = data;
+            cs_data.dest_addr = _dest;
 
             bool not_found = false;
 
@@ -3970,22 +4021,19 @@ namespace Emulation {
                 return;
             }
 
-            callstack.emplace_back(cs_data);
-            stackpointerLastCall = Regs.SP;
-            callCount++;
-
-            //callCount -= returnCount;
-            //returnCount = 0;
-
-            LOG_WARN(callstack.size(), ": ", callCount, ", ", returnCount);
+            callstack[callstackDepth % DEBUG_CALLSTACK_DEPTH] = cs_data;
+            callstackSP[callstackDepth % DEBUG_CALLSTACK_DEPTH] = Regs.SP - 2;
+            callstackDepth++;
+            callstackSize = std::min(callstackSize + 1, DEBUG_CALLSTACK_DEPTH);
         }
 
+        // called after the return address got popped, drops every entry whose frame is gone by now
+        // (also covers games which discard a return address and jump back on their own)
         void GameboyCPU::RemoveFromCallstack() {
-            if (stackpointerLastCall == Regs.SP) {
-                callstack.pop_back();
+            while (callstackSize > 0 && callstackSP[(callstackDepth - 1) % DEBUG_CALLSTACK_DEPTH] < Regs.SP) {
+                callstackDepth--;
+                callstackSize--;
             }
-            returnCount++;
-            LOG_WARN(callstack.size(), ": ", callCount, ", ", returnCount);
         }
     }
 }
\ No newline at end of file
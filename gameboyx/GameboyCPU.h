@@ -100,6 +100,19 @@ namespace Emulation {
 			INT_JOYPAD
 		};
 
+		// everything of the CPU which survives a RunCycles call, the instruction context is only valid within one
+		struct cpu_state {
+			registers regs;
+			bool was_halted = false;
+			bool ime_enable = false;
+			bool ime = false;
+
+			bool tima_en_and_div_overflow_prev = false;
+			bool apu_div_bit_overflow_prev = false;
+
+			int tick_counter = 0;
+		};
+
 		/* ***********************************************************************************************************
 			GameboyCPU CLASS DECLARATION
 		*********************************************************************************************************** */
@@ -108,7 +121,9 @@ namespace Emulation {
 			friend class BaseCPU;
 			// constructor
 			explicit GameboyCPU(std::shared_ptr<BaseCartridge> _cartridge);
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			void RunCycles() override;
 			void RunCycle() override;
@@ -116,6 +131,7 @@ namespace Emulation {
 			void GetHardwareInfo(std::vector<data_entry>& _hardware_info) const override;
 			void GetInstrDebugFlags(std::vector<reg_entry>& _register_values, std::vector<reg_entry>& _flag_values, std::vector<reg_entry>& _misc_values) const override;
 			void UpdateDebugData(debug_data* _data) const override;
+			void GetDebugIndex(int& _bank, int& _pc) const override;
 
 			void GenerateAssemblyTables(std::shared_ptr<BaseCartridge> _cartridge) override;
 			void GenerateTemporaryAssemblyTable(assembly_tables& _table) override;
@@ -132,6 +148,9 @@ namespace Emulation {
 			u16 data;
 
 			void RunCpu();
+			int nextInputPoll = 0;
+
+			cpu_state savedState = cpu_state();
 
 			void ExecuteInstruction() override;
 			bool CheckInterrupts() override;
@@ -192,9 +211,8 @@ namespace Emulation {
 
 			void AddToCallstack(const u16& _dest);
 			void RemoveFromCallstack();
-			int callCount = 0;
-			int returnCount = 0;
-			u16 stackpointerLastCall = 0x00;
+			// stack pointer of each entry once the return address got pushed
+			std::array<u16, DEBUG_CALLSTACK_DEPTH> callstackSP = {};
 
 			// basic instruction set *****
 			void NoInstruction();
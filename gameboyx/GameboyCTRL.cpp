@@ -1,50 +1,108 @@
 #include "GameboyCTRL.h"
+#include "Machine.h"
 #include "gameboy_defines.h"
 
 namespace Emulation {
 	namespace Gameboy {
 		GameboyCTRL::GameboyCTRL(std::shared_ptr<BaseCartridge> _cartridge) : BaseCTRL() {}
 
-		void GameboyCTRL::Init() {
-			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(BaseMEM::s_GetInstance());
+		void GameboyCTRL::Init(const Machine& _machine) {
+			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(_machine.GetMem());
 			controlCtx = m_MemInstance.lock()->GetControlContext();
 		}
 
+		// brings the emulated buttons in line with the newest host state, runs on the emulation thread so the
+		// interrupt of a new press gets raised in emulated time
+		void GameboyCTRL::LatchInput() {
+			if (inputFrozen) { return; }
+
+			// nothing published since the last applied event, buttons set directly (e.g. batch scripts) stay untouched
+			u64 published = inputState.load(std::memory_order_acquire);
+			u32 sequence = (u32)(published >> 32);
+			if (sequence == appliedSequence) { return; }
+			appliedSequence = sequence;
+
+			// compared against the emulated buttons, restored states change them as well
+			u32 state = (u32)published & BUTTON_MASK;
+			u32 changed = state ^ GetAppliedState();
+			if (changed == 0) { return; }
+
+			for (int i = 0; i < SDL_CONTROLLER_BUTTON_MAX; i++) {
+				if ((changed & (1u << i)) == 0) { continue; }
+
+				if (state & (1u << i)) {
+					SetKey(0, (SDL_GameControllerButton)i);
+				} else {
+					ResetKey(0, (SDL_GameControllerButton)i);
+				}
+			}
+		}
+
+		u32 GameboyCTRL::GetAppliedState() const {
+			u32 state = 0;
+			if (controlCtx->start_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_X; }
+			if (controlCtx->select_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_Y; }
+			if (controlCtx->b_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_B; }
+			if (controlCtx->a_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_A; }
+			if (controlCtx->down_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_DPAD_DOWN; }
+			if (controlCtx->up_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_DPAD_UP; }
+			if (controlCtx->left_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_DPAD_LEFT; }
+			if (controlCtx->right_pressed) { state |= 1u << SDL_CONTROLLER_BUTTON_DPAD_RIGHT; }
+			return state;
+		}
+
 		bool GameboyCTRL::SetKey(const int& _player, const SDL_GameControllerButton& _key) {
 			// set bool in case cpu writes to joyp register and requires current states to set the right bits
-			// and directly set the corresponding bit and request interrupt in case of a high to low transition
+			// and directly set the corresponding bit and request interrupt in case of a high to low transition,
+			// the queued events and the late latch may both apply the same press
 			switch (_key) {
 			case SDL_CONTROLLER_BUTTON_X:
-				controlCtx->start_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_START_DOWN, true);
+				if (!controlCtx->start_pressed) {
+					controlCtx->start_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_START_DOWN, true);
+				}
 				break;
 			case SDL_CONTROLLER_BUTTON_Y:
-				controlCtx->select_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_SELECT_UP, true);
+				if (!controlCtx->select_pressed) {
+					controlCtx->select_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_SELECT_UP, true);
+				}
 				break;
 			case SDL_CONTROLLER_BUTTON_B:
-				controlCtx->b_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_B_LEFT, true);
+				if (!controlCtx->b_pressed) {
+					controlCtx->b_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_B_LEFT, true);
+				}
 				break;
 			case SDL_CONTROLLER_BUTTON_A:
-				controlCtx->a_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_A_RIGHT, true);
+				if (!controlCtx->a_pressed) {
+					controlCtx->a_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_A_RIGHT, true);
+				}
 				break;
 			case SDL_CONTROLLER_BUTTON_DPAD_DOWN:
-				controlCtx->down_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_START_DOWN, false);
+				if (!controlCtx->down_pressed) {
+					controlCtx->down_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_START_DOWN, false);
+				}
 				break;
 			case SDL_CONTROLLER_BUTTON_DPAD_UP:
-				controlCtx->up_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_SELECT_UP, false);
+				if (!controlCtx->up_pressed) {
+					controlCtx->up_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_SELECT_UP, false);
+				}
 				break;
 			case SDL_CONTROLLER_BUTTON_DPAD_LEFT:
-				controlCtx->left_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_B_LEFT, false);
+				if (!controlCtx->left_pressed) {
+					controlCtx->left_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_B_LEFT, false);
+				}
 				break;
 			case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:
-				controlCtx->right_pressed = true;
-				m_MemInstance.lock()->SetButton(JOYP_A_RIGHT, false);
+				if (!controlCtx->right_pressed) {
+					controlCtx->right_pressed = true;
+					m_MemInstance.lock()->SetButton(JOYP_A_RIGHT, false);
+				}
 				break;
 			default:
 				return false;
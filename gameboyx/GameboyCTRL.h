@@ -9,16 +9,22 @@ namespace Emulation {
 			friend class BaseCTRL;
 			// constructor
 			explicit GameboyCTRL(std::shared_ptr<BaseCartridge> _cartridge);
-			void Init() override;
+			void Init(const Machine& _machine) override;
 
 			// members
 			bool SetKey(const int& _player, const SDL_GameControllerButton& _key) override;
 			bool ResetKey(const int& _player, const SDL_GameControllerButton& _key) override;
+			void LatchInput() override;
 
 		private:
 			// memory access
 			std::weak_ptr<GameboyMEM> m_MemInstance;
 			control_context* controlCtx;
+
+			// buttons currently applied to the emulated hardware, same layout as inputState
+			u32 GetAppliedState() const;
+			static constexpr u32 BUTTON_MASK = (1u << SDL_CONTROLLER_BUTTON_X) | (1u << SDL_CONTROLLER_BUTTON_Y) | (1u << SDL_CONTROLLER_BUTTON_B) | (1u << SDL_CONTROLLER_BUTTON_A) |
+				(1u << SDL_CONTROLLER_BUTTON_DPAD_DOWN) | (1u << SDL_CONTROLLER_BUTTON_DPAD_UP) | (1u << SDL_CONTROLLER_BUTTON_DPAD_LEFT) | (1u << SDL_CONTROLLER_BUTTON_DPAD_RIGHT);
 		};
 	}
 }
\ No newline at end of file
@@ -1,10 +1,13 @@
 #include "GameboyGPU.h"
+#include "Machine.h"
 
 #include "gameboy_defines.h"
 #include "logger.h"
 #include "general_config.h"
 
 #include <format>
+#include <algorithm>
+#include <bit>
 
 using namespace std;
 
@@ -17,30 +20,130 @@ namespace Emulation {
 		GameboyGPU::GameboyGPU(std::shared_ptr<BaseCartridge> _cartridge) : BaseGPU() {}
 
 		GameboyGPU::~GameboyGPU() {
-			Backend::HardwareMgr::DestroyGraphicsBackend();
+			StopRenderThread();
+			if (presentFrames) {
+				Backend::HardwareMgr::DestroyGraphicsBackend();
+			}
 		}
 
-		void GameboyGPU::Init() {
-			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(BaseMEM::s_GetInstance());
-			m_CoreInstance = std::dynamic_pointer_cast<GameboyCPU>(BaseCPU::s_GetInstance());
+		void GameboyGPU::Init(const Machine& _machine) {
+			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(_machine.GetMem());
+			m_CoreInstance = std::dynamic_pointer_cast<GameboyCPU>(_machine.GetCore());
+			profiler = _machine.GetProfiler().get();
 
 			graphicsCtx = m_MemInstance.lock()->GetGraphicsContext();
 			machineCtx = m_MemInstance.lock()->GetMachineContext();
-			if (machineCtx->is_cgb || machineCtx->cgb_compatibility) {
+			// compatibility mode without boot ROM runs as DMG
+			if (machineCtx->is_cgb || (machineCtx->cgb_compatibility && machineCtx->boot_rom_mapped)) {
 				SetHardwareMode(GBC);
 			} else {
 				SetHardwareMode(GB);
 			}
 
-			imageData = std::vector<u8>(PPU_SCREEN_X * PPU_SCREEN_Y * TEX2D_CHANNELS);
+			InitColorLUTs();
+			InitPixelFormat();
+
+			imageData = std::vector<u8>(PPU_SCREEN_X * PPU_SCREEN_Y * pixelSize);
+			dirtyLines = std::vector<u64>((PPU_SCREEN_Y + 63) / 64);
+
+			// the graphics backend presents RGBA8888 only, other formats are for consumers of the frame buffer
+			presentFrames = pixelFormat == PIXEL_FORMAT_RGBA8888;
+			if (presentFrames) {
+				Backend::virtual_graphics_information virt_graphics_info = {};
+				virt_graphics_info.is2d = virt_graphics_info.en2d = true;
+				virt_graphics_info.image_data = &imageData;
+				virt_graphics_info.aspect_ratio = LCD_ASPECT_RATIO;
+				virt_graphics_info.lcd_width = PPU_SCREEN_X;
+				virt_graphics_info.lcd_height = PPU_SCREEN_Y;
+				Backend::HardwareMgr::InitGraphicsBackend(virt_graphics_info);
+			} else {
+				LOG_WARN("[emu] pixel format not supported by the graphics backend, frames don't get presented");
+			}
+		}
 
-			Backend::virtual_graphics_information virt_graphics_info = {};
-			virt_graphics_info.is2d = virt_graphics_info.en2d = true;
-			virt_graphics_info.image_data = &imageData;
-			virt_graphics_info.aspect_ratio = LCD_ASPECT_RATIO;
-			virt_graphics_info.lcd_width = PPU_SCREEN_X;
-			virt_graphics_info.lcd_height = PPU_SCREEN_Y;
-			Backend::HardwareMgr::InitGraphicsBackend(virt_graphics_info);
+		/* ***********************************************************************************************************
+			STATE
+		*********************************************************************************************************** */
+		// the render thread has to be idle, it might still draw lines of the state being replaced
+		void GameboyGPU::SaveState() {
+			FlushScanlines();
+
+			savedState.tick_counter = tickCounter;
+			savedState.frame_counter = frameCounter;
+
+			savedState.stat_signal = statSignal;
+			savedState.stat_signal_prev = statSignalPrev;
+			savedState.mode_3_dots = mode3Dots;
+			savedState.draw_window = drawWindow;
+			savedState.render_frame = renderFrame;
+
+			memcpy(savedState.OAMPrio0, OAMPrio0, sizeof(OAMPrio0));
+			savedState.numOAMPrio0 = numOAMPrio0;
+			memcpy(savedState.OAMPrio1, OAMPrio1, sizeof(OAMPrio1));
+			savedState.numOAMPrio1 = numOAMPrio1;
+
+			savedState.lines_latched = linesLatched;
+			savedState.lines_rendered = linesRendered;
+			savedState.line = scanlineCtxs[linesLatched % PPU_SCREEN_Y];
+		}
+
+		void GameboyGPU::RestoreState() {
+			FlushScanlines();
+
+			tickCounter = savedState.tick_counter;
+			frameCounter = savedState.frame_counter;
+
+			statSignal = savedState.stat_signal;
+			statSignalPrev = savedState.stat_signal_prev;
+			mode3Dots = savedState.mode_3_dots;
+			drawWindow = savedState.draw_window;
+			renderFrame = savedState.render_frame;
+
+			memcpy(OAMPrio0, savedState.OAMPrio0, sizeof(OAMPrio0));
+			numOAMPrio0 = savedState.numOAMPrio0;
+			memcpy(OAMPrio1, savedState.OAMPrio1, sizeof(OAMPrio1));
+			numOAMPrio1 = savedState.numOAMPrio1;
+
+			linesLatched = savedState.lines_latched;
+			linesRendered = savedState.lines_rendered;
+			scanlineCtxs[linesLatched % PPU_SCREEN_Y] = savedState.line;
+		}
+
+		// the palettes hold colors in the output format, the memory initialized them as RGBA8888
+		void GameboyGPU::InitPixelFormat() {
+			switch (pixelSize) {
+			case 2:
+				StorePixel = &GameboyGPU::StorePixel16;
+				break;
+			default:
+				StorePixel = &GameboyGPU::StorePixel32;
+				break;
+			}
+
+			colorWhite = ConvertColor(CGB_DMG_COLOR_WHITE, pixelFormat);
+
+			for (int i = 0; i < 4; i++) {
+				graphicsCtx->dmg_colors[DMG_COLORS_DMG][i] = ConvertColor(graphicsCtx->dmg_colors[DMG_COLORS_DMG][i], pixelFormat);
+				graphicsCtx->dmg_colors[DMG_COLORS_CGB][i] = ConvertColor(graphicsCtx->dmg_colors[DMG_COLORS_CGB][i], pixelFormat);
+				graphicsCtx->dmg_bgp_color_palette[i] = ConvertColor(graphicsCtx->dmg_bgp_color_palette[i], pixelFormat);
+				graphicsCtx->dmg_obp0_color_palette[i] = ConvertColor(graphicsCtx->dmg_obp0_color_palette[i], pixelFormat);
+				graphicsCtx->dmg_obp1_color_palette[i] = ConvertColor(graphicsCtx->dmg_obp1_color_palette[i], pixelFormat);
+			}
+			for (int i = 0; i < 8; i++) {
+				for (int j = 0; j < 4; j++) {
+					graphicsCtx->cgb_bgp_color_palettes[i][j] = ConvertColor(graphicsCtx->cgb_bgp_color_palettes[i][j], pixelFormat);
+					graphicsCtx->cgb_obp_color_palettes[i][j] = ConvertColor(graphicsCtx->cgb_obp_color_palettes[i][j], pixelFormat);
+				}
+			}
+		}
+
+		void GameboyGPU::StorePixel32(u8* _dst, const u32& _color) {
+			memcpy(_dst, &_color, sizeof(u32));
+		}
+
+		void GameboyGPU::StorePixel16(u8* _dst, const u32& _color) {
+			u16 color = (u16)_color;
+			memcpy(_dst, &color, sizeof(u16));
 		}
 
 		// return delta t per frame in microseconds
@@ -74,13 +177,59 @@ namespace Emulation {
 			}
 		}
 
+		void GameboyGPU::GetHardwareInfo(std::vector<data_entry>& _hardware_info) const {
+			_hardware_info.emplace_back("PPU engine", renderThreadEnable ? "Scanline (render thread)" : "Scanline");
+			_hardware_info.emplace_back("Dirty lines", std::format("{:d}/{:d}", dirtyLineCount.load(), PPU_SCREEN_Y));
+		}
+
+		void GameboyGPU::SetRenderThreadEnable(const bool& _enable) {
+			if (_enable == renderThreadEnable) { return; }
+
+			if (_enable) {
+				StartRenderThread();
+			} else {
+				StopRenderThread();
+			}
+		}
+
+		void GameboyGPU::SetColorCorrection(const bool& _enable) {
+			graphicsCtx->cgb_color_lut = colorLUTs[_enable ? 1 : 0].data();
+		}
+
+		// CGB palette writes only do a lookup, the conversion of all 32768 colors (to the output format) happens once here
+		void GameboyGPU::InitColorLUTs() {
+			auto& lut_raw = colorLUTs[0];
+			auto& lut_corrected = colorLUTs[1];
+			lut_raw = std::vector<u32>(PPU_CGB_COLORS);
+			lut_corrected = std::vector<u32>(PPU_CGB_COLORS);
+
+			for (int i = 0; i < PPU_CGB_COLORS; i++) {
+				u32 r = (u32)(i & PPU_CGB_RED);
+				u32 g = (u32)(i & PPU_CGB_GREEN) >> 5;
+				u32 b = (u32)(i & PPU_CGB_BLUE) >> 10;
+
+				// leftshift each value by 3 -> 5 bit to 8 bit 'scaling'
+				lut_raw[i] = ConvertColor((r << 27) | (g << 19) | (b << 11) | 0xFF, pixelFormat);
+
+				// mix the channels like the CGB LCD does (washed out, less saturated colors)
+				u32 r_ = std::min(r * 26 + g * 4 + b * 2, (u32)PPU_CGB_COLOR_CORRECTION_MAX) >> 2;
+				u32 g_ = std::min(g * 24 + b * 8, (u32)PPU_CGB_COLOR_CORRECTION_MAX) >> 2;
+				u32 b_ = std::min(r * 6 + g * 4 + b * 22, (u32)PPU_CGB_COLOR_CORRECTION_MAX) >> 2;
+				lut_corrected[i] = ConvertColor((r_ << 24) | (g_ << 16) | (b_ << 8) | 0xFF, pixelFormat);
+			}
+
+			graphicsCtx->cgb_color_lut = lut_raw.data();
+		}
+
 		void GameboyGPU::SetHardwareMode(const console_ids& _id) {
 			switch(_id) {
 			case GBC:
+				cgbMode = true;
 				DrawScanline = &GameboyGPU::DrawScanlineCGB;
 				SearchOam = &GameboyGPU::SearchOAMCGB;
 				break;
 			case GB:
+				cgbMode = false;
 				DrawScanline = &GameboyGPU::DrawScanlineDMG;
 				SearchOam = &GameboyGPU::SearchOAMDMG;
 				break;
@@ -91,6 +240,7 @@ namespace Emulation {
 			OAMDMANextBlock();
 
 			if (graphicsCtx->ppu_enable) {
+				ProfileScope profile_scope(profiler, PROFILE_PPU_MODES);
 				int current_ticks = _ticks / machineCtx->currentSpeed;
 
 				u8& ly = m_MemInstance.lock()->GetIO(LY_ADDR);
@@ -103,69 +253,26 @@ namespace Emulation {
 
 					switch (graphicsCtx->mode) {
 					case PPU_MODE_2:
-						statSignal = graphicsCtx->mode_2_int_sel;
-						(this->*SearchOam)(ly);
-
-						if (tickCounter >= PPU_DOTS_MODE_2) {
-							EnterMode3();
-						}
+						TickMode2(ly);
 						break;
 					case PPU_MODE_3:
 						statSignal = false;
+						graphicsCtx->line_dots = tickCounter;
 
 						if (tickCounter >= PPU_DOTS_MODE_3_MIN + PPU_DOTS_MODE_2) {
-							int offset_y = ly * PPU_SCREEN_X * TEX2D_CHANNELS;
-							memset(&imageData[offset_y], 0xFF, PPU_SCREEN_X * TEX2D_CHANNELS);
-							(this->*DrawScanline)(ly);
+							SubmitScanline();
 							EnterMode0();
 						}
 						break;
 					case PPU_MODE_0:
-						statSignal = graphicsCtx->mode_0_int_sel;
-
-						if (tickCounter >= PPU_DOTS_PER_SCANLINE) {
-							tickCounter = 0;
-							ly++;
-
-							if (ly >= LCD_SCANLINES_VBLANK) {
-								Backend::HardwareMgr::UpdateTexture2d();
-								frameCounter++;
-								EnterMode1();
-							} else {
-								EnterMode2();
-							}
-						}
+						TickMode0(ly);
 						break;
 					case PPU_MODE_1:
-						statSignal = graphicsCtx->mode_1_int_sel || graphicsCtx->mode_2_int_sel;
-
-						if (tickCounter >= PPU_DOTS_PER_SCANLINE) {
-							tickCounter = 0;
-							ly++;
-							if (ly == LCD_SCANLINES_TOTAL) {
-								ly = 0x00;
-								EnterMode2();
-
-								presentObjPrio0Set = presentObjPrio0.load();
-								presentObjPrio1Set = presentObjPrio1.load();
-								presentBackgroundSet = presentBackground.load();
-								presentWindowSet = presentWindow.load();
-							}
-						}
+						TickMode1(ly);
 						break;
 					}
 
-					if (ly == lyc) {
-						stat |= PPU_STAT_LYC_FLAG;
-						statSignal = statSignal || graphicsCtx->lyc_ly_int_sel;
-					} else {
-						stat &= ~PPU_STAT_LYC_FLAG;
-					}
-
-					if (statSignal && !statSignalPrev) {
-						m_MemInstance.lock()->RequestInterrupts(IRQ_LCD_STAT);
-					}
-					statSignalPrev = statSignal;
+					UpdateStatSignal(ly, lyc, stat);
 				}
 
 				graphicsCtx->vblank_if_write = false;
@@ -178,16 +285,75 @@ namespace Emulation {
 		}
 
 
+		// mode 2, 0 and 1 don't depend on how mode 3 gets emulated, these are shared with the pixel FIFO engine
+		void GameboyGPU::TickMode2(const u8& _ly) {
+			statSignal = graphicsCtx->mode_2_int_sel;
+
+			if (tickCounter >= PPU_DOTS_MODE_2) {
+				(this->*SearchOam)(_ly);
+				EnterMode3();
+			}
+		}
+
+		void GameboyGPU::TickMode0(u8& _ly) {
+			statSignal = graphicsCtx->mode_0_int_sel;
+
+			if (tickCounter >= PPU_DOTS_PER_SCANLINE) {
+				tickCounter = 0;
+				_ly++;
+
+				if (_ly >= LCD_SCANLINES_VBLANK) {
+					frameCounter++;
+					if (renderFrame) {
+						FlushScanlines();
+						CompleteFrame();
+					}
+					EnterMode1();
+				} else {
+					EnterMode2();
+				}
+			}
+		}
+
+		void GameboyGPU::TickMode1(u8& _ly) {
+			statSignal = graphicsCtx->mode_1_int_sel || graphicsCtx->mode_2_int_sel;
+
+			if (tickCounter >= PPU_DOTS_PER_SCANLINE) {
+				tickCounter = 0;
+				_ly++;
+				if (_ly == LCD_SCANLINES_TOTAL) {
+					_ly = 0x00;
+					EnterMode2();
+
+					presentObjPrio0Set = presentObjPrio0.load();
+					presentObjPrio1Set = presentObjPrio1.load();
+					presentBackgroundSet = presentBackground.load();
+					presentWindowSet = presentWindow.load();
+					renderFrame = !renderBypass;
+				}
+			}
+		}
+
+		void GameboyGPU::UpdateStatSignal(const u8& _ly, const u8& _lyc, u8& _stat) {
+			if (_ly == _lyc) {
+				_stat |= PPU_STAT_LYC_FLAG;
+				statSignal = statSignal || graphicsCtx->lyc_ly_int_sel;
+			} else {
+				_stat &= ~PPU_STAT_LYC_FLAG;
+			}
+
+			if (statSignal && !statSignalPrev) {
+				m_MemInstance.lock()->RequestInterrupts(IRQ_LCD_STAT);
+			}
+			statSignalPrev = statSignal;
+		}
+
+
 #define SET_MODE(stat, mode) stat = (stat & PPU_STAT_WRITEABLE_BITS) | mode 
 
 		void GameboyGPU::EnterMode2() {
-			std::fill(objNoPrio.begin(), objNoPrio.end(), false);
-			std::fill(bgwinPrio.begin(), bgwinPrio.end(), false);
-
 			SetMode(PPU_MODE_2);
 
-			oamOffset = 0;
-
 			numOAMPrio1 = 0;
 			numOAMPrio0 = 0;
 		}
@@ -196,6 +362,12 @@ namespace Emulation {
 			u8& ly = m_MemInstance.lock()->GetIO(LY_ADDR);
 
 			SetMode(PPU_MODE_3);
+			// the mode 3 ticks refresh this only after the memory accesses of the CPU
+			graphicsCtx->line_dots = tickCounter;
+
+			if (renderFrame) {
+				LatchScanline(ly);
+			}
 		}
 
 		void GameboyGPU::EnterMode0() {
@@ -219,387 +391,527 @@ namespace Emulation {
 			SET_MODE(stat, _mode);
 		}
 
-
-
-		void GameboyGPU::DrawScanlineDMG(const u8& _ly) {
-			if (graphicsCtx->obj_enable) {
-				if (presentObjPrio0Set) { DrawObjectsDMG(_ly, OAMPrio0, numOAMPrio0, true); }
+		/* ***********************************************************************************************************
+			SCANLINE LATCH AND RENDER THREAD
+		*********************************************************************************************************** */
+		/*
+		*	Everything the scanline renderer reads gets copied into a scanline_context when mode 3 is entered. Register writes
+		*	during mode 3 get logged by the memory (graphics_context::reg_writes) and attached to the line at the end of mode 3,
+		*	the renderer then applies them at the matching pixel. Without the render thread the line gets drawn right away
+		*	at the end of mode 3. With the render thread the contexts are queued in a ring of PPU_SCREEN_Y entries and drawn
+		*	concurrently; the emulation thread only waits for the worker on entering VBlank (before the texture gets handed
+		*	to the backend) or when the ring is full.
+		*	VRAM can't be written during mode 3 but between lines, so the worker gets a copy of it which is only
+		*	renewed when the VRAM version changed (copy on write).
+		*/
+		scanline_context& GameboyGPU::LatchScanline(const u8& _ly) {
+			auto mem_instance = m_MemInstance.lock();
+
+			if (renderThreadEnable) {
+				std::unique_lock<std::mutex> lock_render(mutRender);
+				notifyRenderDone.wait(lock_render, [this] { return linesLatched - linesRendered < PPU_SCREEN_Y; });
 			}
 
-			if (graphicsCtx->bg_win_enable) {
-				if (presentBackgroundSet) { DrawBackgroundDMG(_ly); }
-				if (graphicsCtx->win_enable) {
-					if (presentWindowSet) { DrawWindowDMG(_ly); }
-				}
+			scanline_context& line = scanlineCtxs[linesLatched % PPU_SCREEN_Y];
+
+			line.ly = _ly;
+			line.scx = mem_instance->GetIO(SCX_ADDR);
+			line.scy = mem_instance->GetIO(SCY_ADDR);
+			line.wx = mem_instance->GetIO(WX_ADDR);
+			line.wy = mem_instance->GetIO(WY_ADDR);
+
+			line.bg_win_enable = graphicsCtx->bg_win_enable;
+			line.obj_prio = graphicsCtx->obj_prio;
+			line.obj_enable = graphicsCtx->obj_enable;
+			line.obj_size_16 = graphicsCtx->obj_size_16;
+			line.bg_tilemap_offset = graphicsCtx->bg_tilemap_offset;
+			line.bg_win_addr_mode_8000 = graphicsCtx->bg_win_addr_mode_8000;
+			line.win_enable = graphicsCtx->win_enable;
+			line.win_tilemap_offset = graphicsCtx->win_tilemap_offset;
+
+			// the window gets triggered once per frame as soon as WY matches LY
+			int wx_ = (int)line.wx - 7;
+			if (line.win_enable && !drawWindow && ((int)line.wy == (int)_ly) && (wx_ > -8 && wx_ < PPU_SCREEN_X)) {
+				drawWindow = true;
 			}
+			line.draw_window = drawWindow;
 
-			if (graphicsCtx->obj_enable) {
-				if (presentObjPrio1Set) { DrawObjectsDMG(_ly, OAMPrio1, numOAMPrio1, false); }
+			memcpy(line.dmg_bgp_color_palette, graphicsCtx->dmg_bgp_color_palette, sizeof(line.dmg_bgp_color_palette));
+			memcpy(line.dmg_obp0_color_palette, graphicsCtx->dmg_obp0_color_palette, sizeof(line.dmg_obp0_color_palette));
+			memcpy(line.dmg_obp1_color_palette, graphicsCtx->dmg_obp1_color_palette, sizeof(line.dmg_obp1_color_palette));
+			if (machineCtx->is_cgb || machineCtx->cgb_compatibility) {
+				memcpy(line.cgb_bgp_color_palettes, graphicsCtx->cgb_bgp_color_palettes, sizeof(line.cgb_bgp_color_palettes));
+				memcpy(line.cgb_obp_color_palettes, graphicsCtx->cgb_obp_color_palettes, sizeof(line.cgb_obp_color_palettes));
 			}
-		}
 
-		// TODO: scx is actually reread on each tile fetch
-		void GameboyGPU::DrawBackgroundDMG(const u8& _ly) {
-			auto tilemap_offset = (int)graphicsCtx->bg_tilemap_offset;
-			int ly = _ly;
-
-			auto scx = (int)m_MemInstance.lock()->GetIO(SCX_ADDR);
-			auto scy = (int)m_MemInstance.lock()->GetIO(SCY_ADDR);
-			int scy_ = (scy + ly) % PPU_TILEMAP_SIZE_1D_PIXELS;
-			int scx_;
+			memcpy(line.OAM, graphicsCtx->OAM.data(), OAM_SIZE);
+			memcpy(line.OAMPrio0, OAMPrio0, sizeof(OAMPrio0));
+			memcpy(line.OAMPrio1, OAMPrio1, sizeof(OAMPrio1));
+			line.numOAMPrio0 = numOAMPrio0;
+			line.numOAMPrio1 = numOAMPrio1;
+
+			line.present_obj_prio0 = presentObjPrio0Set;
+			line.present_obj_prio1 = presentObjPrio1Set;
+			line.present_background = presentBackgroundSet;
+			line.present_window = presentWindowSet;
+
+			if (renderThreadEnable) {
+				line.vram = GetVRAMSnapshot();
+				line.VRAM_N = &line.vram->VRAM_N;
+				line.vram_block_versions = &line.vram->block_versions;
+			} else {
+				line.VRAM_N = &graphicsCtx->VRAM_N;
+				line.vram_block_versions = &graphicsCtx->vram_block_versions;
+			}
 
-			//mode3Dots += scx % 8;
+			line.reg_writes_num = 0;
+			graphicsCtx->reg_writes_num = 0;
 
-			int tilemap_offset_y = ((scy_ / PPU_TILE_SIZE_Y) * PPU_TILEMAP_SIZE_1D) % (PPU_TILEMAP_SIZE_1D * PPU_TILEMAP_SIZE_1D);
-			int tilemap_offset_x;
+			return line;
+		}
 
-			int y_clip = (scy + ly) % PPU_TILE_SIZE_Y;
-			int x_clip = scx % PPU_TILE_SIZE_X;
+		// the latched line is complete at the end of mode 3
+		void GameboyGPU::SubmitScanline() {
+			if (!renderFrame) {
+				graphicsCtx->reg_writes_num = 0;
+				return;
+			}
 
-			u8 tile_offset;
-			for (int x = 0; x < PPU_SCREEN_X + x_clip; x += PPU_TILE_SIZE_X) {
-				scx_ = (scx + x) % PPU_TILEMAP_SIZE_1D_PIXELS;
-				tilemap_offset_x = (scx_ / PPU_TILE_SIZE_X) % PPU_TILEMAP_SIZE_1D;
+			scanline_context& line = scanlineCtxs[linesLatched % PPU_SCREEN_Y];
 
-				tile_offset = graphicsCtx->VRAM_N[0][tilemap_offset + tilemap_offset_y + tilemap_offset_x];
+			line.reg_writes_num = graphicsCtx->reg_writes_num;
+			for (int i = 0; i < line.reg_writes_num; i++) {
+				line.reg_writes[i] = graphicsCtx->reg_writes[i];
+			}
+			graphicsCtx->reg_writes_num = 0;
 
-				FetchTileDataBGWIN(tile_offset, y_clip * 2, 0);
-				DrawTileBGWINDMG(x - x_clip, ly, graphicsCtx->dmg_bgp_color_palette);
+			if (renderThreadEnable) {
+				{
+					std::unique_lock<std::mutex> lock_render(mutRender);
+					linesLatched++;
+				}
+				notifyRender.notify_one();
+			} else {
+				RenderScanline(line);
+				linesLatched++;
+				linesRendered = linesLatched;
 			}
 		}
 
-		void GameboyGPU::DrawWindowDMG(const u8& _ly) {
-			int ly = _ly;
-
-			auto wx = ((int)m_MemInstance.lock()->GetIO(WX_ADDR));
-			auto wy = (int)m_MemInstance.lock()->GetIO(WY_ADDR);
-			auto wx_ = wx - 7;
-
-			if (!drawWindow && (wy == ly) && (wx_ > -8 && wx_ < PPU_SCREEN_X)) {
-				drawWindow = true;
-			}
+		void GameboyGPU::RenderScanline(const scanline_context& _line) {
+			ProfileScope profile_scope(profiler, PROFILE_PPU_RENDER);
+			std::fill(objNoPrio.begin(), objNoPrio.end(), false);
+			std::fill(bgwinPrio.begin(), bgwinPrio.end(), false);
 
-			if (drawWindow) {
-				auto tilemap_offset = (int)graphicsCtx->win_tilemap_offset;
+			// white in every pixel format
+			int offset_y = _line.ly * PPU_SCREEN_X * pixelSize;
+			memset(&imageData[offset_y], 0xFF, PPU_SCREEN_X * pixelSize);
 
-				int tilemap_offset_y = ((ly - wy) / PPU_TILE_SIZE_Y) * PPU_TILEMAP_SIZE_1D;
-				int tilemap_offset_x;
+			clipStart = 0;
+			if (_line.reg_writes_num == 0) {
+				clipEnd = PPU_SCREEN_X;
+				(this->*DrawScanline)(_line);
+			} else {
+				// draw the line in segments, each with the register state valid at that pixel
+				scanline_context line = _line;
 
-				int y_clip = (ly - wy) % PPU_TILE_SIZE_Y;
-				int x_clip = wx_ % PPU_TILE_SIZE_X;
+				for (int i = 0; i < _line.reg_writes_num; i++) {
+					const auto& reg_write = _line.reg_writes[i];
 
-				//mode3Dots += PPU_DOTS_MODE_3_WIN_FETCH;
+					int x = reg_write.dot - (PPU_DOTS_MODE_2 + PPU_DOTS_MODE_3_PIXEL_OFFSET);
+					x = std::clamp(x, 0, PPU_SCREEN_X);
 
-				u8 tile_offset;
-				for (int x = 0; x < PPU_SCREEN_X + x_clip; x += PPU_TILE_SIZE_X) {
-					tilemap_offset_x = (x - wx_) / PPU_TILE_SIZE_X;
+					if (x > clipStart) {
+						clipEnd = x;
+						(this->*DrawScanline)(line);
+						clipStart = x;
+					}
 
-					tile_offset = graphicsCtx->VRAM_N[0][tilemap_offset + tilemap_offset_y + tilemap_offset_x];
+					ApplyRegisterWrite(line, reg_write);
+				}
 
-					FetchTileDataBGWIN(tile_offset, y_clip * 2, 0);
-					DrawTileBGWINDMG(x, ly, graphicsCtx->dmg_bgp_color_palette);
+				clipEnd = PPU_SCREEN_X;
+				if (clipStart < clipEnd) {
+					(this->*DrawScanline)(line);
 				}
 			}
-		}
 
-		void GameboyGPU::DrawObjectsDMG(const u8& _ly, const int* _objects, const int& _num_objects, const bool& _no_prio) {
-			// TODO: due to drawing objects stored in _objects from last to first element, priority ('z fighting', even though there is no z-axis) gets resolved like on CGB.
-			// on DMG this is actually done by comparing the x coordinate of the objects in oam. the smaller value wins
-
-			for (int i = _num_objects - 1; i > -1; i--) {
-				int oam_offset = _objects[i];
-
-				int y_pos = (int)graphicsCtx->OAM[oam_offset + OBJ_ATTR_Y];
-				int x_pos = (int)graphicsCtx->OAM[oam_offset + OBJ_ATTR_X];
-				u8 tile_offset = graphicsCtx->OAM[oam_offset + OBJ_ATTR_INDEX];
-				u8 flags = graphicsCtx->OAM[oam_offset + OBJ_ATTR_FLAGS];
+			HashLine(_line.ly);
+		}
 
-				int ly = _ly;
+		void GameboyGPU::ApplyRegisterWrite(scanline_context& _line, const ppu_register_write& _reg_write) {
+			const u8& data = _reg_write.data;
 
-				int y_clip;
-				if (graphicsCtx->obj_size_16) {
-					if (flags & OBJ_ATTR_Y_FLIP) {
-						y_clip = y_pos - ly - 1;
-					} else {
-						y_clip = PPU_TILE_SIZE_Y_16 - (y_pos - ly);
-					}
-				} else {
-					if (flags & OBJ_ATTR_Y_FLIP) {
-						y_clip = (y_pos - ly) - (PPU_TILE_SIZE_Y + 1);
-					} else {
-						y_clip = PPU_TILE_SIZE_Y - ((y_pos - ly) - PPU_TILE_SIZE_Y);
-					}
-				}
-
-				u32* palette;
-				if (flags & OBJ_ATTR_PALETTE_DMG) {
-					palette = graphicsCtx->dmg_obp1_color_palette;
-				} else {
-					palette = graphicsCtx->dmg_obp0_color_palette;
-				}
+			switch (_reg_write.addr) {
+			case SCX_ADDR:
+				_line.scx = data;
+				break;
+			case SCY_ADDR:
+				_line.scy = data;
+				break;
+			case WX_ADDR:
+				_line.wx = data;
+				break;
+			case WY_ADDR:
+				_line.wy = data;
+				break;
+			case BGP_ADDR:
+				memcpy(_line.dmg_bgp_color_palette, _reg_write.color_palette, sizeof(_line.dmg_bgp_color_palette));
+				break;
+			case OBP0_ADDR:
+				memcpy(_line.dmg_obp0_color_palette, _reg_write.color_palette, sizeof(_line.dmg_obp0_color_palette));
+				break;
+			case OBP1_ADDR:
+				memcpy(_line.dmg_obp1_color_palette, _reg_write.color_palette, sizeof(_line.dmg_obp1_color_palette));
+				break;
+			case LCDC_ADDR:
+				_line.bg_win_enable = (data & PPU_LCDC_WINBG_EN_PRIO) ? true : false;
+				_line.obj_prio = _line.bg_win_enable;
+				_line.obj_enable = (data & PPU_LCDC_OBJ_ENABLE) ? true : false;
+				_line.obj_size_16 = (data & PPU_LCDC_OBJ_SIZE) ? true : false;
+				_line.bg_tilemap_offset = (data & PPU_LCDC_BG_TILEMAP) ? PPU_TILE_MAP1 - VRAM_N_OFFSET : PPU_TILE_MAP0 - VRAM_N_OFFSET;
+				_line.bg_win_addr_mode_8000 = (data & PPU_LCDC_WINBG_TILEDATA) ? true : false;
+				_line.win_enable = (data & PPU_LCDC_WIN_ENABLE) ? true : false;
+				_line.win_tilemap_offset = (data & PPU_LCDC_WIN_TILEMAP) ? PPU_TILE_MAP1 - VRAM_N_OFFSET : PPU_TILE_MAP0 - VRAM_N_OFFSET;
+				break;
+			}
+		}
 
-				bool x_flip = (flags & OBJ_ATTR_X_FLIP) ? true : false;
+		// FNV-1a over 64 bit words while the line is still in cache, a line is 320 or 640 bytes depending on the pixel format
+		void GameboyGPU::HashLine(const int& _ly) {
+			const int line_size = PPU_SCREEN_X * pixelSize;
+			const u8* line = &imageData[_ly * line_size];
+			u64 hash = 0xcbf29ce484222325;
+			u64 word;
+			for (int i = 0; i < line_size; i += sizeof(u64)) {
+				memcpy(&word, line + i, sizeof(u64));
+				hash = (hash ^ word) * 0x100000001b3;
+			}
 
-				FetchTileDataOBJ(tile_offset, y_clip * 2, 0);
-				DrawTileOBJ(x_pos - 8, ly, palette, _no_prio, x_flip);
+			if (!lineHashesValid || hash != lineHashes[_ly]) {
+				dirtyLines[_ly >> 6] |= (u64)1 << (_ly & 0x3F);
 			}
+			lineHashes[_ly] = hash;
 		}
 
-		void GameboyGPU::DrawTileOBJ(const int& _x, const int& _y, const u32* _color_palette, const bool& _no_prio, const bool& _x_flip) {
-			int image_offset_y = _y * PPU_SCREEN_X * TEX2D_CHANNELS;
-			int image_offset_x;
-			int color_index = 0;
-			u32 color;
+		// all lines are drawn, hand the frame and its dirty lines out and start the next mask
+		void GameboyGPU::CompleteFrame() {
+			int dirty_count = 0;
+			for (const auto& n : dirtyLines) {
+				dirty_count += std::popcount(n);
+			}
+			dirtyLineCount.store(dirty_count);
+			lineHashesValid = true;
 
-			u8 bit_mask = _x_flip ? 0x01 : 0x80;
-			int x = _x;
+			// identical frames don't need to be uploaded again
+			if (presentFrames && dirty_count > 0) {
+				Backend::HardwareMgr::UpdateTexture2d();
+			}
+			PublishFrame(PPU_SCREEN_X, PPU_SCREEN_Y);
 
-			if (_x_flip) {
-				for (int i = 0; i < 8; i++) {
-					if (x > -1 && x < PPU_SCREEN_X) {
-						color_index = (((tileDataCur[1] & bit_mask) >> i) << 1) | ((tileDataCur[0] & bit_mask) >> i);
+			std::fill(dirtyLines.begin(), dirtyLines.end(), (u64)0);
+		}
 
-						if (color_index > 0 && !bgwinPrio[x]) {
-							color = _color_palette[color_index];
-							image_offset_x = x * TEX2D_CHANNELS;
+		// wait for all latched lines, afterwards the render thread is idle until the next line gets latched
+		void GameboyGPU::FlushScanlines() {
+			if (renderThreadEnable) {
+				std::unique_lock<std::mutex> lock_render(mutRender);
+				notifyRenderDone.wait(lock_render, [this] { return linesRendered == linesLatched; });
 
-							u32 color_mask = 0xFF000000;
-							for (int k = 0, j = 3 * 8; j > -1; j -= 8, k++) {
-								imageData[image_offset_y + image_offset_x + k] = (u8)((color & color_mask) >> j);
-								color_mask >>= 8;
-							}
+				// release the snapshots held by the ring, unused ones can be reused within the next frame
+				for (auto& n : scanlineCtxs) {
+					n.vram.reset();
+				}
+			}
+		}
 
-							if (_no_prio) { objNoPrio[x] = true; }
-						}
+		std::shared_ptr<vram_snapshot> GameboyGPU::GetVRAMSnapshot() {
+			if (!vramSnapshot || vramSnapshot->version != graphicsCtx->vram_version) {
+				std::shared_ptr<vram_snapshot> snapshot;
+				for (const auto& n : vramSnapshotPool) {
+					if (n.use_count() == 1) {
+						snapshot = n;
+						break;
 					}
-
-					bit_mask <<= 1;
-					x++;
 				}
-			} else {
-				for (int i = 7; i > -1; i--) {
-					if (x > -1 && x < PPU_SCREEN_X) {
-						color_index = (((tileDataCur[1] & bit_mask) >> i) << 1) | ((tileDataCur[0] & bit_mask) >> i);
 
-						if (color_index > 0 && !bgwinPrio[x]) {
-							color = _color_palette[color_index];
-							image_offset_x = x * TEX2D_CHANNELS;
+				if (!snapshot) {
+					snapshot = std::make_shared<vram_snapshot>();
+					vramSnapshotPool.emplace_back(snapshot);
+				}
 
-							u32 color_mask = 0xFF000000;
-							for (int k = 0, j = 3 * 8; j > -1; j -= 8, k++) {
-								imageData[image_offset_y + image_offset_x + k] = (u8)((color & color_mask) >> j);
-								color_mask >>= 8;
+				const auto& vram = graphicsCtx->VRAM_N;
+				const auto& versions = graphicsCtx->vram_block_versions;
+				if (snapshot->VRAM_N.size() != vram.size() || snapshot->block_versions.size() != versions.size()) {
+					snapshot->VRAM_N = vram;
+					snapshot->block_versions = versions;
+				} else {
+					// a reused snapshot only needs the tiles written since it was taken
+					for (size_t bank = 0; bank < versions.size(); bank++) {
+						auto& snapshot_versions = snapshot->block_versions[bank];
+						for (size_t block = 0; block < versions[bank].size(); block++) {
+							if (snapshot_versions[block] != versions[bank][block]) {
+								size_t offset = block * PPU_VRAM_TILE_SIZE;
+								std::copy(vram[bank].begin() + offset, vram[bank].begin() + offset + PPU_VRAM_TILE_SIZE, snapshot->VRAM_N[bank].begin() + offset);
+								snapshot_versions[block] = versions[bank][block];
 							}
-
-							if (_no_prio) { objNoPrio[x] = true; }
 						}
 					}
-
-					bit_mask >>= 1;
-					x++;
 				}
+				snapshot->version = graphicsCtx->vram_version;
+				vramSnapshot = snapshot;
 			}
+
+			return vramSnapshot;
 		}
 
-		void GameboyGPU::DrawTileBGWINDMG(const int& _x, const int& _y, const u32* _color_palette) {
-			int image_offset_y = _y * PPU_SCREEN_X * TEX2D_CHANNELS;
-			int image_offset_x;
-			int color_index = 0;
-			u32 color;
+		void GameboyGPU::StartRenderThread() {
+			renderThreadShutdown = false;
+			linesRendered = linesLatched;
+			renderThreadEnable = true;
 
-			u8 bit_mask = 0x80;
-			int x = _x;
-			for (int i = 7; i > -1; i--) {
-				if (x > -1 && x < PPU_SCREEN_X) {
-					color_index = (((tileDataCur[1] & bit_mask) >> i) << 1) | ((tileDataCur[0] & bit_mask) >> i);
+			renderThread = std::thread([this]() -> void { ProcessRenderThread(); });
+			LOG_INFO("[emu] render thread started");
+		}
 
-					bool draw = false;
-					if (objNoPrio[x]) {
-						draw = color_index != 0;
-					} else {
-						draw = true;
-					}
+		void GameboyGPU::StopRenderThread() {
+			if (!renderThreadEnable) { return; }
 
-					if (draw) {
-						color = _color_palette[color_index];
+			FlushScanlines();
+			{
+				std::unique_lock<std::mutex> lock_render(mutRender);
+				renderThreadShutdown = true;
+			}
+			notifyRender.notify_one();
 
-						image_offset_x = x * TEX2D_CHANNELS;
+			if (renderThread.joinable()) {
+				renderThread.join();
+			}
 
-						u32 color_mask = 0xFF000000;
-						for (int k = 0, j = 3 * 8; j > -1; j -= 8, k++) {
-							imageData[image_offset_y + image_offset_x + k] = (u8)((color & color_mask) >> j);
-							color_mask >>= 8;
-						}
-					}
+			renderThreadEnable = false;
+			vramSnapshot.reset();
+			vramSnapshotPool.clear();
+		}
+
+		void GameboyGPU::ProcessRenderThread() {
+			std::unique_lock<std::mutex> lock_render(mutRender);
+
+			while (true) {
+				notifyRender.wait(lock_render, [this] { return renderThreadShutdown || linesRendered < linesLatched; });
+				if (renderThreadShutdown && linesRendered == linesLatched) { break; }
+
+				// lines between linesRendered and linesLatched don't get touched by the emulation thread
+				u64 lines_rendered = linesRendered;
+				u64 lines_latched = linesLatched;
+				lock_render.unlock();
+
+				for (; lines_rendered < lines_latched; lines_rendered++) {
+					RenderScanline(scanlineCtxs[lines_rendered % PPU_SCREEN_Y]);
 				}
 
-				bit_mask >>= 1;
-				x++;
+				// the emulation thread collects the time with the next frame
+				if (profiler != nullptr) { profiler->Flush(); }
+
+				lock_render.lock();
+				linesRendered = lines_rendered;
+				notifyRenderDone.notify_one();
 			}
 		}
 
-		void GameboyGPU::DrawScanlineCGB(const u8& _ly) {
-			if (graphicsCtx->obj_enable) {
-				if (presentObjPrio0Set) { DrawObjectsCGB(_ly, OAMPrio0, numOAMPrio0, true); }
-			}
 
-			if (presentBackgroundSet) { DrawBackgroundCGB(_ly); }
 
-			if (graphicsCtx->win_enable) {
-				if (presentWindowSet) { DrawWindowCGB(_ly); }
+		void GameboyGPU::DrawScanlineDMG(const scanline_context& _line) {
+			if (_line.obj_enable) {
+				if (_line.present_obj_prio0) { DrawObjectsDMG(_line, _line.OAMPrio0, _line.numOAMPrio0, true); }
 			}
 
-			if (graphicsCtx->obj_enable) {
-				if (presentObjPrio1Set) { DrawObjectsCGB(_ly, OAMPrio1, numOAMPrio1, false); }
+			if (_line.bg_win_enable) {
+				if (_line.present_background) { DrawBackground(_line); }
+				if (_line.win_enable) {
+					if (_line.present_window) { DrawWindow(_line); }
+				}
 			}
-		}
 
-		void GameboyGPU::DrawBackgroundCGB(const u8& _ly) {
-			auto tilemap_offset = (int)graphicsCtx->bg_tilemap_offset;
-			int ly = _ly;
+			if (_line.obj_enable) {
+				if (_line.present_obj_prio1) { DrawObjectsDMG(_line, _line.OAMPrio1, _line.numOAMPrio1, false); }
+			}
+		}
 
-			auto scx = (int)m_MemInstance.lock()->GetIO(SCX_ADDR);
-			auto scy = (int)m_MemInstance.lock()->GetIO(SCY_ADDR);
-			int scy_ = (scy + ly) % PPU_TILEMAP_SIZE_1D_PIXELS;
-			int scx_;
+		void GameboyGPU::DrawBackground(const scanline_context& _line) {
+			int y = ((int)_line.scy + (int)_line.ly) % PPU_TILEMAP_SIZE_1D_PIXELS;
 
-			//mode3Dots += scx % 8;
+			DrawPlaneRow(_line, _line.bg_tilemap_offset, y, (int)_line.scx, 0);
+		}
 
-			int tilemap_offset_y = ((scy_ / PPU_TILE_SIZE_Y) * PPU_TILEMAP_SIZE_1D) % (PPU_TILEMAP_SIZE_1D * PPU_TILEMAP_SIZE_1D);
-			int tilemap_offset_x;
+		void GameboyGPU::DrawWindow(const scanline_context& _line) {
+			if (_line.draw_window) {
+				int wx_ = (int)_line.wx - 7;
 
-			int y_clip = (scy + ly) % PPU_TILE_SIZE_Y;
-			int x_clip = scx % PPU_TILE_SIZE_X;
+				// the window starts at WX - 7 with column 0 of its tilemap
+				DrawPlaneRow(_line, _line.win_tilemap_offset, (int)_line.ly - (int)_line.wy, wx_ < 0 ? -wx_ : 0, std::max(wx_, 0));
+			}
+		}
 
-			int bank;
-			int palette_index;
-			bool x_flip;
-			bool y_flip;
-			bool prio;
+		/* ***********************************************************************************************************
+			BACKGROUND PLANE CACHE
+		*********************************************************************************************************** */
+		/*
+		*	Both tilemaps get kept decoded as 256x256 planes (one per tile data addressing mode), each entry holds the color
+		*	index and for CGB the palette and priority of the tile, flips already applied. A tile of a plane only gets decoded
+		*	again when the VRAM blocks of its tilemap entry or its tile data have been written since (graphics_context::
+		*	vram_block_versions), so a scrolling but otherwise static background gets drawn by copying a row of the plane.
+		*/
+		void GameboyGPU::DrawPlaneRow(const scanline_context& _line, const u16& _tilemap_offset, const int& _y, const int& _x_src, const int& _x_dst) {
+			int length = PPU_SCREEN_X - _x_dst;
+			if (length <= 0 || _y < 0 || _y >= PPU_TILEMAP_SIZE_1D_PIXELS) { return; }
+
+			bg_plane& plane = bgPlanes[_tilemap_offset == PPU_TILE_MAP0 - VRAM_N_OFFSET ? 0 : 1][_line.bg_win_addr_mode_8000 ? 1 : 0];
+
+			int x_src = _x_src % PPU_TILEMAP_SIZE_1D_PIXELS;
+			int tilemap_offset_y = (_y / PPU_TILE_SIZE_Y) * PPU_TILEMAP_SIZE_1D;
+			int tilemap_offset_x = x_src / PPU_TILE_SIZE_X;
+			int tiles = ((x_src % PPU_TILE_SIZE_X) + length + PPU_TILE_SIZE_X - 1) / PPU_TILE_SIZE_X;
+			for (int i = 0; i < tiles; i++) {
+				UpdatePlaneTile(_line, plane, _tilemap_offset, tilemap_offset_y + ((tilemap_offset_x + i) % PPU_TILEMAP_SIZE_1D));
+			}
 
-			int y_clip_;
+			// visible part of the row, wraps around at the right edge of the plane
+			const u8* row = &plane.pixels[_y * PPU_TILEMAP_SIZE_1D_PIXELS];
+			int length_first = std::min(length, PPU_TILEMAP_SIZE_1D_PIXELS - x_src);
+			memcpy(planeRow, row + x_src, length_first);
+			if (length_first < length) {
+				memcpy(planeRow + length_first, row, length - length_first);
+			}
 
-			u8 tile_offset;
-			u8 tile_attr;
-			for (int x = 0; x < PPU_SCREEN_X + x_clip; x += PPU_TILE_SIZE_X) {
-				scx_ = (scx + x) % PPU_TILEMAP_SIZE_1D_PIXELS;
-				tilemap_offset_x = (scx_ / PPU_TILE_SIZE_X) % PPU_TILEMAP_SIZE_1D;
+			int image_offset_y = _line.ly * PPU_SCREEN_X * pixelSize;
+			u32 color;
 
-				int index = tilemap_offset + tilemap_offset_y + tilemap_offset_x;
-				tile_offset = graphicsCtx->VRAM_N[0][index];
-				tile_attr = graphicsCtx->VRAM_N[1][index];
+			for (int x = std::max(_x_dst, clipStart); x < clipEnd; x++) {
+				u8 entry = planeRow[x - _x_dst];
+				int color_index = entry & PPU_PLANE_COLOR_INDEX;
 
-				palette_index = tile_attr & BG_ATTR_PALETTE_CGB;
-				bank = (tile_attr & BG_ATTR_VRAM_BANK_CGB ? 1 : 0);
-				x_flip = (tile_attr & BG_ATTR_FLIP_HORIZONTAL ? true : false);
-				y_flip = (tile_attr & BG_ATTR_FLIP_VERTICAL ? true : false);
-				prio = (tile_attr & BG_ATTR_OAM_PRIORITY ? true : false);
+				if (objNoPrio[x] && color_index == 0) { continue; }
 
-				if (y_flip) {
-					y_clip_ = (PPU_TILE_SIZE_Y - 1) - y_clip;
+				if (cgbMode) {
+					color = _line.cgb_bgp_color_palettes[(entry & PPU_PLANE_PALETTE) >> PPU_PLANE_PALETTE_SHIFT][color_index];
+					if ((entry & PPU_PLANE_PRIO) && color_index != 0) { bgwinPrio[x] = true; }
 				} else {
-					y_clip_ = y_clip;
+					color = _line.dmg_bgp_color_palette[color_index];
 				}
 
-				FetchTileDataBGWIN(tile_offset, y_clip_ * 2, bank);
-				DrawTileBGWINCGB(x - x_clip, ly, graphicsCtx->cgb_bgp_color_palettes[palette_index], x_flip, prio);
+				StorePixel(&imageData[image_offset_y + x * pixelSize], color);
 			}
 		}
 
-		void GameboyGPU::DrawWindowCGB(const u8& _ly) {
-			int ly = _ly;
+		void GameboyGPU::UpdatePlaneTile(const scanline_context& _line, bg_plane& _plane, const u16& _tilemap_offset, const int& _index) {
+			const auto& vram = *_line.VRAM_N;
+			const auto& versions = *_line.vram_block_versions;
 
-			auto wx = ((int)m_MemInstance.lock()->GetIO(WX_ADDR));
-			auto wy = (int)m_MemInstance.lock()->GetIO(WY_ADDR);
-			auto wx_ = wx - 7;
+			int tilemap_index = _tilemap_offset + _index;
+			int tilemap_block = tilemap_index / PPU_VRAM_TILE_SIZE;
 
-			if (!drawWindow && (wy == ly) && (wx_ > -8 && wx_ < PPU_SCREEN_X)) {
-				drawWindow = true;
+			u8 tile_offset = vram[0][tilemap_index];
+			u8 tile_attr = cgbMode ? vram[1][tilemap_index] : 0x00;
+			int bank = (tile_attr & BG_ATTR_VRAM_BANK_CGB) ? 1 : 0;
+
+			int tile_index;
+			if (_line.bg_win_addr_mode_8000) {
+				tile_index = (PPU_VRAM_BASEPTR_8000 - VRAM_N_OFFSET) + (tile_offset * 0x10);
+			} else {
+				tile_index = (PPU_VRAM_BASEPTR_8800 - VRAM_N_OFFSET) + (*(i8*)&tile_offset * 0x10);
 			}
 
-			if (drawWindow) {
-				int bank;
-				int palette_index;
-				bool x_flip;
-				bool y_flip;
-				bool prio;
+			// versions only increase, the sum of both banks changes with every write to the tilemap entries
+			u32 tilemap_version = versions[0][tilemap_block] + (cgbMode ? versions[1][tilemap_block] : 0);
+			u32 tile_version = versions[bank][tile_index / PPU_VRAM_TILE_SIZE];
 
-				auto tilemap_offset = (int)graphicsCtx->win_tilemap_offset;
+			bg_plane_tile& tile = _plane.tiles[_index];
+			if (tile.valid && tile.cgb_mode == cgbMode && tile.tilemap_version == tilemap_version && tile.tile_version == tile_version) { return; }
 
-				int tilemap_offset_y = ((ly - wy) / PPU_TILE_SIZE_Y) * PPU_TILEMAP_SIZE_1D;
-				int tilemap_offset_x;
+			bool x_flip = (tile_attr & BG_ATTR_FLIP_HORIZONTAL) ? true : false;
+			bool y_flip = (tile_attr & BG_ATTR_FLIP_VERTICAL) ? true : false;
+			u8 entry_attr = (u8)(((tile_attr & BG_ATTR_PALETTE_CGB) << PPU_PLANE_PALETTE_SHIFT) | ((tile_attr & BG_ATTR_OAM_PRIORITY) ? PPU_PLANE_PRIO : 0x00));
 
-				int y_clip = (ly - wy) % PPU_TILE_SIZE_Y;
-				int x_clip = wx_ % PPU_TILE_SIZE_X;
+			int plane_offset = (_index / PPU_TILEMAP_SIZE_1D) * PPU_TILE_SIZE_Y * PPU_TILEMAP_SIZE_1D_PIXELS + (_index % PPU_TILEMAP_SIZE_1D) * PPU_TILE_SIZE_X;
 
-				int y_clip_;
+			for (int y = 0; y < PPU_TILE_SIZE_Y; y++) {
+				int tile_y = y_flip ? (PPU_TILE_SIZE_Y - 1) - y : y;
+				u8 data_low = vram[bank][tile_index + tile_y * PPU_TILE_SIZE_SCANLINE];
+				u8 data_high = vram[bank][tile_index + tile_y * PPU_TILE_SIZE_SCANLINE + 1];
 
-				u8 tile_offset;
-				u8 tile_attr;
-				for (int x = 0; x < PPU_SCREEN_X + x_clip; x += PPU_TILE_SIZE_X) {
-					tilemap_offset_x = (x - wx_) / PPU_TILE_SIZE_X;
+				u8* pixels = &_plane.pixels[plane_offset + y * PPU_TILEMAP_SIZE_1D_PIXELS];
+				for (int x = 0; x < PPU_TILE_SIZE_X; x++) {
+					int bit = x_flip ? x : 7 - x;
+					pixels[x] = (u8)((((data_high >> bit) & 0x01) << 1) | ((data_low >> bit) & 0x01)) | entry_attr;
+				}
+			}
+
+			tile.valid = true;
+			tile.cgb_mode = cgbMode;
+			tile.tilemap_version = tilemap_version;
+			tile.tile_version = tile_version;
+		}
 
-					tile_offset = graphicsCtx->VRAM_N[0][tilemap_offset + tilemap_offset_y + tilemap_offset_x];
+		void GameboyGPU::DrawObjectsDMG(const scanline_context& _line, const int* _objects, const int& _num_objects, const bool& _no_prio) {
+			// TODO: due to drawing objects stored in _objects from last to first element, priority ('z fighting', even though there is no z-axis) gets resolved like on CGB.
+			// on DMG this is actually done by comparing the x coordinate of the objects in oam. the smaller value wins
+
+			for (int i = _num_objects - 1; i > -1; i--) {
+				int oam_offset = _objects[i];
 
-					int index = tilemap_offset + tilemap_offset_y + tilemap_offset_x;
-					tile_offset = graphicsCtx->VRAM_N[0][index];
-					tile_attr = graphicsCtx->VRAM_N[1][index];
+				int y_pos = (int)_line.OAM[oam_offset + OBJ_ATTR_Y];
+				int x_pos = (int)_line.OAM[oam_offset + OBJ_ATTR_X];
+				u8 tile_offset = _line.OAM[oam_offset + OBJ_ATTR_INDEX];
+				u8 flags = _line.OAM[oam_offset + OBJ_ATTR_FLAGS];
 
-					palette_index = tile_attr & BG_ATTR_PALETTE_CGB;
-					bank = (tile_attr & BG_ATTR_VRAM_BANK_CGB ? 1 : 0);
-					x_flip = (tile_attr & BG_ATTR_FLIP_HORIZONTAL ? true : false);
-					y_flip = (tile_attr & BG_ATTR_FLIP_VERTICAL ? true : false);
-					prio = (tile_attr & BG_ATTR_OAM_PRIORITY ? true : false);
+				int ly = _line.ly;
 
-					if (y_flip) {
-						y_clip_ = (PPU_TILE_SIZE_Y - 1) - y_clip;
+				int y_clip;
+				if (_line.obj_size_16) {
+					if (flags & OBJ_ATTR_Y_FLIP) {
+						y_clip = y_pos - ly - 1;
+					} else {
+						y_clip = PPU_TILE_SIZE_Y_16 - (y_pos - ly);
+					}
+				} else {
+					if (flags & OBJ_ATTR_Y_FLIP) {
+						y_clip = (y_pos - ly) - (PPU_TILE_SIZE_Y + 1);
 					} else {
-						y_clip_ = y_clip;
+						y_clip = PPU_TILE_SIZE_Y - ((y_pos - ly) - PPU_TILE_SIZE_Y);
 					}
+				}
 
-					FetchTileDataBGWIN(tile_offset, y_clip_ * 2, bank);
-					DrawTileBGWINCGB(x, ly, graphicsCtx->dmg_bgp_color_palette, x_flip, prio);
+				const u32* palette;
+				if (flags & OBJ_ATTR_PALETTE_DMG) {
+					palette = _line.dmg_obp1_color_palette;
+				} else {
+					palette = _line.dmg_obp0_color_palette;
 				}
+
+				bool x_flip = (flags & OBJ_ATTR_X_FLIP) ? true : false;
+
+				FetchTileDataOBJ(_line, tile_offset, y_clip * 2, 0);
+				DrawTileOBJ(x_pos - 8, ly, palette, _no_prio, x_flip);
 			}
 		}
 
-		void GameboyGPU::DrawTileBGWINCGB(const int& _x, const int& _y, const u32* _color_palette, const bool& _x_flip, const bool& _prio) {
-			int image_offset_y = _y * PPU_SCREEN_X * TEX2D_CHANNELS;
-			int image_offset_x;
+		void GameboyGPU::DrawTileOBJ(const int& _x, const int& _y, const u32* _color_palette, const bool& _no_prio, const bool& _x_flip) {
+			int image_offset_y = _y * PPU_SCREEN_X * pixelSize;
 			int color_index = 0;
-			u32 color;
 
 			u8 bit_mask = _x_flip ? 0x01 : 0x80;
 			int x = _x;
 
 			if (_x_flip) {
 				for (int i = 0; i < 8; i++) {
-					if (x > -1 && x < PPU_SCREEN_X) {
+					if (x >= clipStart && x < clipEnd) {
 						color_index = (((tileDataCur[1] & bit_mask) >> i) << 1) | ((tileDataCur[0] & bit_mask) >> i);
 
-						bool draw = false;
-
-						if (objNoPrio[x]) {
-							draw = color_index != 0;
-						} else {
-							draw = true;
-						}
-
-						if (draw) {
-							color = _color_palette[color_index];
-
-							image_offset_x = x * TEX2D_CHANNELS;
-
-							u32 color_mask = 0xFF000000;
-							for (int k = 0, j = 3 * 8; j > -1; j -= 8, k++) {
-								imageData[image_offset_y + image_offset_x + k] = (u8)((color & color_mask) >> j);
-								color_mask >>= 8;
-							}
+						if (color_index > 0 && !bgwinPrio[x]) {
+							StorePixel(&imageData[image_offset_y + x * pixelSize], _color_palette[color_index]);
 
-							if (_prio && color_index != 0) { bgwinPrio[x] = true; }
+							if (_no_prio) { objNoPrio[x] = true; }
 						}
-
-
 					}
 
 					bit_mask <<= 1;
@@ -607,29 +919,13 @@ namespace Emulation {
 				}
 			} else {
 				for (int i = 7; i > -1; i--) {
-					if (x > -1 && x < PPU_SCREEN_X) {
+					if (x >= clipStart && x < clipEnd) {
 						color_index = (((tileDataCur[1] & bit_mask) >> i) << 1) | ((tileDataCur[0] & bit_mask) >> i);
 
-						bool draw = false;
-
-						if (objNoPrio[x]) {
-							draw = color_index != 0;
-						} else {
-							draw = true;
-						}
-
-						if (draw) {
-							color = _color_palette[color_index];
-
-							image_offset_x = x * TEX2D_CHANNELS;
-
-							u32 color_mask = 0xFF000000;
-							for (int k = 0, j = 3 * 8; j > -1; j -= 8, k++) {
-								imageData[image_offset_y + image_offset_x + k] = (u8)((color & color_mask) >> j);
-								color_mask >>= 8;
-							}
+						if (color_index > 0 && !bgwinPrio[x]) {
+							StorePixel(&imageData[image_offset_y + x * pixelSize], _color_palette[color_index]);
 
-							if (_prio && color_index != 0) { bgwinPrio[x] = true; }
+							if (_no_prio) { objNoPrio[x] = true; }
 						}
 					}
 
@@ -639,22 +935,38 @@ namespace Emulation {
 			}
 		}
 
-		void GameboyGPU::DrawObjectsCGB(const u8& _ly, const int* _objects, const int& _num_objects, const bool& _no_prio) {
+		void GameboyGPU::DrawScanlineCGB(const scanline_context& _line) {
+			if (_line.obj_enable) {
+				if (_line.present_obj_prio0) { DrawObjectsCGB(_line, _line.OAMPrio0, _line.numOAMPrio0, true); }
+			}
+
+			if (_line.present_background) { DrawBackground(_line); }
+
+			if (_line.win_enable) {
+				if (_line.present_window) { DrawWindow(_line); }
+			}
+
+			if (_line.obj_enable) {
+				if (_line.present_obj_prio1) { DrawObjectsCGB(_line, _line.OAMPrio1, _line.numOAMPrio1, false); }
+			}
+		}
+
+		void GameboyGPU::DrawObjectsCGB(const scanline_context& _line, const int* _objects, const int& _num_objects, const bool& _no_prio) {
 			// TODO: due to drawing objects stored in _objects from last to first element, priority ('z fighting', even though there is no z-axis) gets resolved like on CGB.
 			// on DMG this is actually done by comparing the x coordinate of the objects in oam. the smaller value wins
 
 			for (int i = _num_objects - 1; i > -1; i--) {
 				int oam_offset = _objects[i];
 
-				int y_pos = (int)graphicsCtx->OAM[oam_offset + OBJ_ATTR_Y];
-				int x_pos = (int)graphicsCtx->OAM[oam_offset + OBJ_ATTR_X];
-				u8 tile_offset = graphicsCtx->OAM[oam_offset + OBJ_ATTR_INDEX];
-				u8 flags = graphicsCtx->OAM[oam_offset + OBJ_ATTR_FLAGS];
+				int y_pos = (int)_line.OAM[oam_offset + OBJ_ATTR_Y];
+				int x_pos = (int)_line.OAM[oam_offset + OBJ_ATTR_X];
+				u8 tile_offset = _line.OAM[oam_offset + OBJ_ATTR_INDEX];
+				u8 flags = _line.OAM[oam_offset + OBJ_ATTR_FLAGS];
 
-				int ly = _ly;
+				int ly = _line.ly;
 
 				int y_clip;
-				if (graphicsCtx->obj_size_16) {
+				if (_line.obj_size_16) {
 					if (flags & OBJ_ATTR_Y_FLIP) {
 						y_clip = y_pos - ly - 1;
 					} else {
@@ -669,103 +981,99 @@ namespace Emulation {
 				}
 
 				int palette_index = flags & OBJ_ATTR_PALETTE_CGB;
-				u32* palette = graphicsCtx->cgb_obp_color_palettes[palette_index];
+				const u32* palette = _line.cgb_obp_color_palettes[palette_index];
 				int bank = flags & OBJ_ATTR_VRAM_BANK_CGB ? 1 : 0;
 
 				bool x_flip = (flags & OBJ_ATTR_X_FLIP) ? true : false;
 
-				FetchTileDataOBJ(tile_offset, y_clip * 2, bank);
+				FetchTileDataOBJ(_line, tile_offset, y_clip * 2, bank);
 				DrawTileOBJ(x_pos - 8, ly, palette, _no_prio, x_flip);
 			}
 		}
 
-		void GameboyGPU::SearchOAMDMG(const u8& _ly) {
-			if (graphicsCtx->obj_enable) {
-				if (oamOffset < OAM_SIZE) {
-					int y_pos;
-					int ly = _ly;
-					bool no_prio;
-					bool add_entry = false;
-
-					y_pos = (int)graphicsCtx->OAM[oamOffset + OBJ_ATTR_Y];
-
-					add_entry =
-						(graphicsCtx->obj_size_16 && ((y_pos - ly) > 0 && (y_pos - _ly) < (16 + 1))) ||
-						((y_pos - ly) > 8 && (y_pos - _ly) < (16 + 1));
-
-					if (add_entry) {
-						no_prio = (graphicsCtx->OAM[oamOffset + OBJ_ATTR_FLAGS] & OBJ_ATTR_PRIO) ? true : false;
-
-						if (numOAMPrio0 + numOAMPrio1 < 10) {
-							if (no_prio) {
-								OAMPrio0[numOAMPrio0] = oamOffset;
-								numOAMPrio0++;
-							} else {
-								OAMPrio1[numOAMPrio1] = oamOffset;
-								numOAMPrio1++;
-							}
-						}
+		/*
+		*	The objects visible on each line only change with OAM or the object size, so instead of walking OAM during
+		*	every mode 2 the objects get binned for all lines at once whenever graphics_context::oam_dirty is set.
+		*	Mode 2 then only splits the (up to 10, in OAM order) objects of the line by priority.
+		*/
+		void GameboyGPU::BinObjects() {
+			for (int i = 0; i < PPU_SCREEN_Y; i++) {
+				numObjectBins[i] = 0;
+			}
+
+			int height = graphicsCtx->obj_size_16 ? PPU_TILE_SIZE_Y_16 : PPU_TILE_SIZE_Y;
+
+			for (int oam_offset = 0; oam_offset < OAM_SIZE; oam_offset += PPU_OBJ_ATTR_BYTES) {
+				// y position is stored + 16
+				int first_line = (int)graphicsCtx->OAM[oam_offset + OBJ_ATTR_Y] - PPU_TILE_SIZE_Y_16;
+				int last_line = first_line + height;
+
+				for (int ly = std::max(first_line, 0); ly < std::min(last_line, PPU_SCREEN_Y); ly++) {
+					if (numObjectBins[ly] < PPU_OBJ_PER_SCANLINE) {
+						objectBins[ly][numObjectBins[ly]] = oam_offset;
+						numObjectBins[ly]++;
 					}
+				}
+			}
+
+			graphicsCtx->oam_dirty = false;
+		}
+
+		void GameboyGPU::SearchOAMDMG(const u8& _ly) {
+			numOAMPrio0 = 0;
+			numOAMPrio1 = 0;
+
+			if (graphicsCtx->obj_enable && _ly < PPU_SCREEN_Y) {
+				if (graphicsCtx->oam_dirty) {
+					BinObjects();
+				}
+
+				for (int i = 0; i < numObjectBins[_ly]; i++) {
+					int oam_offset = objectBins[_ly][i];
 
-					oamOffset += PPU_OBJ_ATTR_BYTES;
+					if (graphicsCtx->OAM[oam_offset + OBJ_ATTR_FLAGS] & OBJ_ATTR_PRIO) {
+						OAMPrio0[numOAMPrio0] = oam_offset;
+						numOAMPrio0++;
+					} else {
+						OAMPrio1[numOAMPrio1] = oam_offset;
+						numOAMPrio1++;
+					}
 				}
 			}
 		}
 
 		void GameboyGPU::SearchOAMCGB(const u8& _ly) {
-			if (graphicsCtx->obj_enable) {
-				if (oamOffset < OAM_SIZE) {
-					int y_pos;
-					int ly = _ly;
-					bool no_prio;
-					bool add_entry = false;
-
-					y_pos = (int)graphicsCtx->OAM[oamOffset + OBJ_ATTR_Y];
-
-					add_entry =
-						(graphicsCtx->obj_size_16 && ((y_pos - ly) > 0 && (y_pos - _ly) < (16 + 1))) ||
-						((y_pos - ly) > 8 && (y_pos - _ly) < (16 + 1));
-
-					if (add_entry) {
-						no_prio = (graphicsCtx->OAM[oamOffset + OBJ_ATTR_FLAGS] & OBJ_ATTR_PRIO) ? true : false;
-
-						if (numOAMPrio0 + numOAMPrio1 < 10) {
-							if (no_prio && graphicsCtx->obj_prio) {
-								OAMPrio0[numOAMPrio0] = oamOffset;
-								numOAMPrio0++;
-							} else {
-								OAMPrio1[numOAMPrio1] = oamOffset;
-								numOAMPrio1++;
-							}
-						}
-					}
+			numOAMPrio0 = 0;
+			numOAMPrio1 = 0;
+
+			if (graphicsCtx->obj_enable && _ly < PPU_SCREEN_Y) {
+				if (graphicsCtx->oam_dirty) {
+					BinObjects();
+				}
 
-					oamOffset += PPU_OBJ_ATTR_BYTES;
+				for (int i = 0; i < numObjectBins[_ly]; i++) {
+					int oam_offset = objectBins[_ly][i];
+
+					if ((graphicsCtx->OAM[oam_offset + OBJ_ATTR_FLAGS] & OBJ_ATTR_PRIO) && graphicsCtx->obj_prio) {
+						OAMPrio0[numOAMPrio0] = oam_offset;
+						numOAMPrio0++;
+					} else {
+						OAMPrio1[numOAMPrio1] = oam_offset;
+						numOAMPrio1++;
+					}
 				}
 			}
 		}
 
-		void GameboyGPU::FetchTileDataOBJ(u8& _tile_offset, const int& _tile_sub_offset, const int& _bank) {
-			if (graphicsCtx->obj_size_16) {
+		void GameboyGPU::FetchTileDataOBJ(const scanline_context& _line, u8& _tile_offset, const int& _tile_sub_offset, const int& _bank) {
+			if (_line.obj_size_16) {
 				int tile_sub_index = (PPU_VRAM_BASEPTR_8000 - VRAM_N_OFFSET) + ((_tile_offset & 0xFE) * 0x10) + _tile_sub_offset;
-				tileDataCur[0] = graphicsCtx->VRAM_N[_bank][tile_sub_index];
-				tileDataCur[1] = graphicsCtx->VRAM_N[_bank][tile_sub_index + 1];
+				tileDataCur[0] = (*_line.VRAM_N)[_bank][tile_sub_index];
+				tileDataCur[1] = (*_line.VRAM_N)[_bank][tile_sub_index + 1];
 			} else {
 				int tile_sub_index = (PPU_VRAM_BASEPTR_8000 - VRAM_N_OFFSET) + (_tile_offset * 0x10) + _tile_sub_offset;
-				tileDataCur[0] = graphicsCtx->VRAM_N[_bank][tile_sub_index];
-				tileDataCur[1] = graphicsCtx->VRAM_N[_bank][tile_sub_index + 1];
-			}
-		}
-
-		void GameboyGPU::FetchTileDataBGWIN(u8& _tile_offset, const int& _tile_sub_offset, const int& _bank) {
-			if (graphicsCtx->bg_win_addr_mode_8000) {
-				int tile_sub_index = (PPU_VRAM_BASEPTR_8000 - VRAM_N_OFFSET) + (_tile_offset * 0x10) + _tile_sub_offset;
-				tileDataCur[0] = graphicsCtx->VRAM_N[_bank][tile_sub_index];
-				tileDataCur[1] = graphicsCtx->VRAM_N[_bank][tile_sub_index + 1];
-			} else {
-				int tile_sub_index = (PPU_VRAM_BASEPTR_8800 - VRAM_N_OFFSET) + (*(i8*)&_tile_offset * 0x10) + _tile_sub_offset;
-				tileDataCur[0] = graphicsCtx->VRAM_N[_bank][tile_sub_index];
-				tileDataCur[1] = graphicsCtx->VRAM_N[_bank][tile_sub_index + 1];
+				tileDataCur[0] = (*_line.VRAM_N)[_bank][tile_sub_index];
+				tileDataCur[1] = (*_line.VRAM_N)[_bank][tile_sub_index + 1];
 			}
 		}
 
@@ -773,6 +1081,7 @@ namespace Emulation {
 		void GameboyGPU::VRAMDMANextBlock() {
 			if (graphicsCtx->vram_dma) {
 				if (!machineCtx->halted) {
+					ProfileScope profile_scope(profiler, PROFILE_DMA);
 					u8& hdma5 = m_MemInstance.lock()->GetIO(CGB_HDMA5_ADDR);
 					int length = (int)(hdma5 & 0x7F) + 1;
 
@@ -801,6 +1110,7 @@ namespace Emulation {
 						memcpy(&graphicsCtx->VRAM_N[machineCtx->vram_bank_selected][dest_addr], &m_MemInstance.lock()->GetBank(MEM_TYPE::WRAMn, bank)[source_addr], 0x10);
 						break;
 					}
+					m_MemInstance.lock()->MarkVRAMWrite(machineCtx->vram_bank_selected, dest_addr, 0x10);
 
 					--length;
 
@@ -827,6 +1137,7 @@ namespace Emulation {
 		void GameboyGPU::OAMDMANextBlock() {
 			if (graphicsCtx->oam_dma) {
 				if (!machineCtx->halted) {
+					ProfileScope profile_scope(profiler, PROFILE_DMA);
 					int bank;
 
 					int& counter = graphicsCtx->oam_dma_counter;
@@ -853,6 +1164,8 @@ namespace Emulation {
 						break;
 					}
 
+					graphicsCtx->oam_dirty = true;
+
 					counter++;
 					if (counter == OAM_DMA_LENGTH) {
 						graphicsCtx->oam_dma = false;
@@ -11,16 +11,112 @@
 #include "GameboyMEM.h"
 #include "GameboyCPU.h"
 #include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace Emulation {
 	namespace Gameboy {
+		// copy of VRAM handed to the render thread, replaced whenever graphics_context::vram_version changes
+		struct vram_snapshot {
+			std::vector<std::vector<u8>> VRAM_N;
+			std::vector<std::vector<u32>> block_versions;
+			u32 version = 0;
+		};
+
+		// PPU state latched on entering mode 3, everything needed to draw one scanline
+		struct scanline_context {
+			u8 ly = 0;
+			u8 scx = 0;
+			u8 scy = 0;
+			u8 wx = 0;
+			u8 wy = 0;
+
+			// LCDC
+			bool bg_win_enable = false;
+			bool obj_prio = false;
+			bool obj_enable = false;
+			bool obj_size_16 = false;
+			u16 bg_tilemap_offset = 0;
+			bool bg_win_addr_mode_8000 = false;
+			bool win_enable = false;
+			u16 win_tilemap_offset = 0;
+
+			bool draw_window = false;
+
+			u32 dmg_bgp_color_palette[4] = {};
+			u32 dmg_obp0_color_palette[4] = {};
+			u32 dmg_obp1_color_palette[4] = {};
+			u32 cgb_bgp_color_palettes[8][4] = {};
+			u32 cgb_obp_color_palettes[8][4] = {};
+
+			// selected objects, offsets into OAM
+			u8 OAM[OAM_SIZE] = {};
+			int OAMPrio0[PPU_OBJ_PER_SCANLINE] = {};
+			int numOAMPrio0 = 0;
+			int OAMPrio1[PPU_OBJ_PER_SCANLINE] = {};
+			int numOAMPrio1 = 0;
+
+			// debug
+			bool present_obj_prio0 = true;
+			bool present_obj_prio1 = true;
+			bool present_background = true;
+			bool present_window = true;
+
+			// writes during mode 3 of this line, sorted by dot
+			ppu_register_write reg_writes[PPU_REG_WRITES_PER_LINE];
+			int reg_writes_num = 0;
+
+			// points either to the live VRAM (synchronous rendering) or to the snapshot held below
+			const std::vector<std::vector<u8>>* VRAM_N = nullptr;
+			const std::vector<std::vector<u32>>* vram_block_versions = nullptr;
+			std::shared_ptr<vram_snapshot> vram;
+		};
+
+		// everything of the PPU which survives a RunCycles call, the frame buffer and the render caches aren't part of it
+		struct gpu_state {
+			int tick_counter = 0;
+			int frame_counter = 0;
+
+			bool stat_signal = false;
+			bool stat_signal_prev = false;
+			int mode_3_dots = 0;
+			bool draw_window = false;
+			bool render_frame = true;
+
+			int OAMPrio0[PPU_OBJ_PER_SCANLINE] = {};
+			int numOAMPrio0 = 0;
+			int OAMPrio1[PPU_OBJ_PER_SCANLINE] = {};
+			int numOAMPrio1 = 0;
+
+			// the latched line gets submitted at the end of mode 3, its slot in the ring might get reused in between
+			u64 lines_latched = 0;
+			u64 lines_rendered = 0;
+			scanline_context line;
+		};
+
+		// decoded tile of a background plane and the VRAM block versions it got decoded from
+		struct bg_plane_tile {
+			bool valid = false;
+			bool cgb_mode = false;
+			u32 tilemap_version = 0;
+			u32 tile_version = 0;
+		};
+
+		struct bg_plane {
+			std::vector<u8> pixels = std::vector<u8>(PPU_TILEMAP_SIZE_1D_PIXELS * PPU_TILEMAP_SIZE_1D_PIXELS, 0);
+			bg_plane_tile tiles[PPU_TILEMAP_SIZE_1D * PPU_TILEMAP_SIZE_1D];
+		};
+
 		class GameboyGPU : public BaseGPU {
 		public:
 			friend class BaseGPU;
 			// constructor
 			GameboyGPU(std::shared_ptr<BaseCartridge> _cartridge);
 			~GameboyGPU() override;
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			// members
 			void ProcessGPU(const int& _ticks) override;
@@ -35,7 +131,12 @@ namespace Emulation {
 			std::vector<std::tuple<int, std::string, bool>> GetGraphicsDebugSettings() override;
 			void SetGraphicsDebugSetting(const bool& _val, const int& _id) override;
 
-		private:
+			void SetRenderThreadEnable(const bool& _enable) override;
+			void GetHardwareInfo(std::vector<data_entry>& _hardware_info) const override;
+
+			void SetColorCorrection(const bool& _enable) override;
+
+		protected:
 			int GetDelayTime() const override;
 			int GetTicksPerFrame(const float& _clock) const override;
 
@@ -47,49 +148,84 @@ namespace Emulation {
 
 			// members
 			void EnterMode2();
-			void EnterMode3();
+			virtual void EnterMode3();
 			void EnterMode0();
 			void EnterMode1();
 
+			void TickMode2(const u8& _ly);
+			void TickMode0(u8& _ly);
+			void TickMode1(u8& _ly);
+			void UpdateStatSignal(const u8& _ly, const u8& _lyc, u8& _stat);
+
+			bool cgbMode = false;
+			// [0] raw and [1] LCD color corrected, owned here so machine states only carry the selection
+			void InitColorLUTs();
+			std::vector<u32> colorLUTs[2];
+
+			// output pixel format, selected once on Init
+			void InitPixelFormat();
+			typedef void (*store_function)(u8* _dst, const u32& _color);
+			store_function StorePixel = nullptr;
+			static void StorePixel32(u8* _dst, const u32& _color);
+			static void StorePixel16(u8* _dst, const u32& _color);
+			u32 colorWhite = CGB_DMG_COLOR_WHITE;
+			bool presentFrames = true;
+			// render bypass latched at the start of each frame
+			bool renderFrame = true;
+
+			gpu_state savedState = gpu_state();
+
+			// hash of every line of the previous frame, each line gets compared right after it got drawn
+			void HashLine(const int& _ly);
+			void CompleteFrame();
+			u64 lineHashes[PPU_SCREEN_Y] = {};
+			bool lineHashesValid = false;
+
 			typedef void (GameboyGPU::* ppu_function)(const u8& _ly);
-			ppu_function DrawScanline;
+			typedef void (GameboyGPU::* draw_function)(const scanline_context& _line);
+			draw_function DrawScanline;
 			ppu_function SearchOam;
-			void DrawScanlineDMG(const u8& _ly);
-			void DrawScanlineCGB(const u8& _ly);
+			void DrawScanlineDMG(const scanline_context& _line);
+			void DrawScanlineCGB(const scanline_context& _line);
 
-			void DrawBackgroundDMG(const u8& _ly);
-			void DrawWindowDMG(const u8& _ly);
-			void DrawObjectsDMG(const u8& _ly, const int* _objects, const int& _num_objects, const bool& _no_prio);
+			void DrawBackground(const scanline_context& _line);
+			void DrawWindow(const scanline_context& _line);
+			void DrawObjectsDMG(const scanline_context& _line, const int* _objects, const int& _num_objects, const bool& _no_prio);
+			void DrawObjectsCGB(const scanline_context& _line, const int* _objects, const int& _num_objects, const bool& _no_prio);
 
 			void DrawTileOBJ(const int& _x, const int& _y, const u32* _color_palette, const bool& _no_prio, const bool& _x_flip);
-			void DrawTileBGWINDMG(const int& _x, const int& _y, const u32* _color_palette);
-
-			void DrawBackgroundCGB(const u8& _ly);
-			void DrawWindowCGB(const u8& _ly);
-			void DrawObjectsCGB(const u8& _ly, const int* _objects, const int& _num_objects, const bool& _no_prio);
 
-			void DrawTileBGWINCGB(const int& _x, const int& _y, const u32* _color_palette, const bool& _x_flip, const bool& _prio);
+			// background/window planes, [tilemap][tile data addressing mode 8000]
+			void DrawPlaneRow(const scanline_context& _line, const u16& _tilemap_offset, const int& _y, const int& _x_src, const int& _x_dst);
+			void UpdatePlaneTile(const scanline_context& _line, bg_plane& _plane, const u16& _tilemap_offset, const int& _index);
+			bg_plane bgPlanes[2][2];
+			u8 planeRow[PPU_SCREEN_X];
 
-			int OAMPrio0[10];
+			int OAMPrio0[PPU_OBJ_PER_SCANLINE];
 			int numOAMPrio0 = 0;
 			std::vector<bool> objNoPrio = std::vector<bool>(PPU_SCREEN_X, false);
-			int OAMPrio1[10];
+			int OAMPrio1[PPU_OBJ_PER_SCANLINE];
 			int numOAMPrio1 = 0;
 			std::vector<bool> bgwinPrio = std::vector<bool>(PPU_SCREEN_X, false);
 
-			int oamOffset = 0;
+			// visible objects per line (OAM offsets), rebuilt when OAM changes
+			void BinObjects();
+			int objectBins[PPU_SCREEN_Y][PPU_OBJ_PER_SCANLINE];
+			int numObjectBins[PPU_SCREEN_Y] = {};
 
 			bool statSignal = false;
 			bool statSignalPrev = false;
 
 			void SearchOAMDMG(const u8& _ly);
 			void SearchOAMCGB(const u8& _ly);
-			void FetchTileDataOBJ(u8& _tile_offset, const int& _tile_sub_offset, const int& _bank);
-
-			void FetchTileDataBGWIN(u8& _tile_offset, const int& _tile_sub_offset, const int& _bank);
+			void FetchTileDataOBJ(const scanline_context& _line, u8& _tile_offset, const int& _tile_sub_offset, const int& _bank);
 
 			u8 tileDataCur[PPU_TILE_SIZE_SCANLINE];
 
+			// pixel range of the current scanline segment, the renderer splits a line at register writes
+			int clipStart = 0;
+			int clipEnd = PPU_SCREEN_X;
+
 			bool drawWindow = false;
 
 			int mode3Dots;
@@ -103,6 +239,32 @@ namespace Emulation {
 			bool presentObjPrio1Set = true;
 			bool presentBackgroundSet = true;
 			bool presentWindowSet = true;
+
+			// scanline rendering, either directly at the end of mode 3 or pipelined on a worker thread
+			scanline_context& LatchScanline(const u8& _ly);
+			void SubmitScanline();
+			void RenderScanline(const scanline_context& _line);
+			void ApplyRegisterWrite(scanline_context& _line, const ppu_register_write& _reg_write);
+			void FlushScanlines();
+			std::shared_ptr<vram_snapshot> GetVRAMSnapshot();
+
+			void StartRenderThread();
+			void StopRenderThread();
+			void ProcessRenderThread();
+
+			std::vector<scanline_context> scanlineCtxs = std::vector<scanline_context>(PPU_SCREEN_Y);
+			u64 linesLatched = 0;
+			u64 linesRendered = 0;
+
+			std::shared_ptr<vram_snapshot> vramSnapshot;
+			std::vector<std::shared_ptr<vram_snapshot>> vramSnapshotPool;
+
+			bool renderThreadEnable = false;
+			bool renderThreadShutdown = false;
+			std::thread renderThread;
+			std::mutex mutRender;
+			std::condition_variable notifyRender;
+			std::condition_variable notifyRenderDone;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,461 @@
+#include "GameboyGPUFIFO.h"
+
+#include "gameboy_defines.h"
+#include "logger.h"
+
+#include <format>
+#include <algorithm>
+
+using namespace std;
+
+namespace Emulation {
+	namespace Gameboy {
+		GameboyGPUFIFO::GameboyGPUFIFO(std::shared_ptr<BaseCartridge> _cartridge) : GameboyGPU(_cartridge) {}
+
+		void GameboyGPUFIFO::SaveState() {
+			GameboyGPU::SaveState();
+
+			fifo_state& state = savedFifoState;
+			std::copy(bgFifo, bgFifo + PPU_TILE_SIZE_X, state.bg_fifo);
+			state.bg_fifo_head = bgFifoHead;
+			state.bg_fifo_size = bgFifoSize;
+			std::copy(objFifo, objFifo + PPU_TILE_SIZE_X, state.obj_fifo);
+			state.obj_fifo_head = objFifoHead;
+
+			state.fetcher = fetcherState;
+			state.fetcher_dots = fetcherDots;
+			state.fetcher_x = fetcherX;
+			state.fetcher_window = fetcherWindow;
+			state.fetcher_dummy = fetcherDummy;
+			state.fetcher_tile_number = fetcherTileNumber;
+			state.fetcher_tile_attr = fetcherTileAttr;
+			state.fetcher_tile_row = fetcherTileRow;
+			state.fetcher_data_low = fetcherDataLow;
+			state.fetcher_data_high = fetcherDataHigh;
+
+			std::copy(lineObjects, lineObjects + PPU_OBJ_PER_SCANLINE, state.line_objects);
+			state.num_line_objects = numLineObjects;
+			state.next_object = nextObject;
+			state.obj_fetch_dots = objFetchDots;
+
+			state.pixel_x = pixelX;
+			state.discard_pixels = discardPixels;
+
+			state.window_line = windowLine;
+			state.window_line_drawn = windowLineDrawn;
+		}
+
+		void GameboyGPUFIFO::RestoreState() {
+			GameboyGPU::RestoreState();
+
+			const fifo_state& state = savedFifoState;
+			std::copy(state.bg_fifo, state.bg_fifo + PPU_TILE_SIZE_X, bgFifo);
+			bgFifoHead = state.bg_fifo_head;
+			bgFifoSize = state.bg_fifo_size;
+			std::copy(state.obj_fifo, state.obj_fifo + PPU_TILE_SIZE_X, objFifo);
+			objFifoHead = state.obj_fifo_head;
+
+			fetcherState = state.fetcher;
+			fetcherDots = state.fetcher_dots;
+			fetcherX = state.fetcher_x;
+			fetcherWindow = state.fetcher_window;
+			fetcherDummy = state.fetcher_dummy;
+			fetcherTileNumber = state.fetcher_tile_number;
+			fetcherTileAttr = state.fetcher_tile_attr;
+			fetcherTileRow = state.fetcher_tile_row;
+			fetcherDataLow = state.fetcher_data_low;
+			fetcherDataHigh = state.fetcher_data_high;
+
+			std::copy(state.line_objects, state.line_objects + PPU_OBJ_PER_SCANLINE, lineObjects);
+			numLineObjects = state.num_line_objects;
+			nextObject = state.next_object;
+			objFetchDots = state.obj_fetch_dots;
+
+			pixelX = state.pixel_x;
+			discardPixels = state.discard_pixels;
+
+			windowLine = state.window_line;
+			windowLineDrawn = state.window_line_drawn;
+		}
+
+		void GameboyGPUFIFO::SetRenderThreadEnable(const bool& _enable) {
+			// pixels get produced dot by dot on the emulation thread, there is nothing to hand off per line
+			if (_enable) {
+				LOG_WARN("[emu] render thread not supported by the pixel FIFO engine");
+			}
+		}
+
+		void GameboyGPUFIFO::GetHardwareInfo(std::vector<data_entry>& _hardware_info) const {
+			_hardware_info.emplace_back("PPU engine", "Pixel FIFO");
+			_hardware_info.emplace_back("Dirty lines", std::format("{:d}/{:d}", dirtyLineCount.load(), PPU_SCREEN_Y));
+		}
+
+		void GameboyGPUFIFO::ProcessGPU(const int& _ticks) {
+			OAMDMANextBlock();
+
+			if (graphicsCtx->ppu_enable) {
+				// the pixels get drawn while stepping mode 3, the rasterization counts to the modes here
+				ProfileScope profile_scope(profiler, PROFILE_PPU_MODES);
+				int current_ticks = _ticks / machineCtx->currentSpeed;
+
+				u8& ly = m_MemInstance.lock()->GetIO(LY_ADDR);
+				const u8& lyc = m_MemInstance.lock()->GetIO(LYC_ADDR);
+				u8& stat = m_MemInstance.lock()->GetIO(STAT_ADDR);
+
+				for (; current_ticks > 0; current_ticks--) {
+
+					tickCounter++;
+
+					switch (graphicsCtx->mode) {
+					case PPU_MODE_2:
+						TickMode2(ly);
+						break;
+					case PPU_MODE_3:
+						TickMode3(ly);
+						break;
+					case PPU_MODE_0:
+						TickMode0(ly);
+						break;
+					case PPU_MODE_1:
+						TickMode1(ly);
+						break;
+					}
+
+					UpdateStatSignal(ly, lyc, stat);
+				}
+
+				graphicsCtx->vblank_if_write = false;
+			} else {
+				statSignal = false;
+				statSignalPrev = false;
+			}
+		}
+
+		/* ***********************************************************************************************************
+			MODE 3
+		*********************************************************************************************************** */
+		/*
+		*	Each dot the fetcher advances and the shifter outputs at most one pixel. The fetcher needs 2 dots for each of
+		*	tile number, tile data low and tile data high and pushes the 8 pixels once the BG FIFO is empty. The first fetch
+		*	of a line gets thrown away, the first SCX % 8 pixels get discarded by the shifter.
+		*	As soon as the shifter reaches an object, fetcher and shifter pause for the object fetch and the object pixels
+		*	get merged into the OBJ FIFO. Mode 3 ends with the 160th pixel.
+		*/
+		void GameboyGPUFIFO::EnterMode3() {
+			auto mem_instance = m_MemInstance.lock();
+			u8& ly = mem_instance->GetIO(LY_ADDR);
+
+			SetMode(PPU_MODE_3);
+			// the mode 3 ticks refresh this only after the memory accesses of the CPU
+			graphicsCtx->line_dots = tickCounter;
+
+			// the window gets triggered once per frame as soon as WY matches LY
+			if (!drawWindow) {
+				windowLine = 0;
+				if (graphicsCtx->win_enable && mem_instance->GetIO(WY_ADDR) == ly) {
+					drawWindow = true;
+				}
+			}
+			windowLineDrawn = false;
+
+			numLineObjects = 0;
+			for (int i = 0; i < numOAMPrio0; i++) {
+				lineObjects[numLineObjects++] = { OAMPrio0[i], (int)graphicsCtx->OAM[OAMPrio0[i] + OBJ_ATTR_X] };
+			}
+			for (int i = 0; i < numOAMPrio1; i++) {
+				lineObjects[numLineObjects++] = { OAMPrio1[i], (int)graphicsCtx->OAM[OAMPrio1[i] + OBJ_ATTR_X] };
+			}
+			std::sort(lineObjects, lineObjects + numLineObjects, [](const fifo_object& _a, const fifo_object& _b) {
+				return _a.x_pos == _b.x_pos ? _a.oam_offset < _b.oam_offset : _a.x_pos < _b.x_pos;
+				});
+			nextObject = 0;
+			objFetchDots = 0;
+
+			bgFifoHead = 0;
+			bgFifoSize = 0;
+			for (auto& n : objFifo) {
+				n = {};
+			}
+			objFifoHead = 0;
+
+			fetcherState = FETCH_TILE;
+			fetcherDots = 0;
+			fetcherX = 0;
+			fetcherWindow = false;
+			fetcherDummy = true;
+
+			pixelX = 0;
+			discardPixels = mem_instance->GetIO(SCX_ADDR) % PPU_TILE_SIZE_X;
+
+			// register writes take effect by themselves, nothing to log for the scanline renderer
+			graphicsCtx->reg_writes_num = 0;
+		}
+
+		void GameboyGPUFIFO::TickMode3(const u8& _ly) {
+			statSignal = false;
+			graphicsCtx->line_dots = tickCounter;
+
+			// fetcher and shifter are paused while an object gets fetched
+			if (objFetchDots > 0) {
+				TickObjectFetch(_ly);
+				return;
+			}
+
+			if (graphicsCtx->obj_enable && nextObject < numLineObjects && bgFifoSize > 0 && discardPixels == 0 &&
+				lineObjects[nextObject].x_pos <= pixelX + PPU_TILE_SIZE_X) {
+				objFetchDots = PPU_OBJ_TILE_FETCH_TICKS;
+				TickObjectFetch(_ly);
+				return;
+			}
+
+			TickFetcher(_ly);
+			ShiftPixel(_ly);
+
+			if (pixelX >= PPU_SCREEN_X) {
+				if (windowLineDrawn) { windowLine++; }
+				if (renderFrame) { HashLine(_ly); }
+				EnterMode0();
+			}
+		}
+
+		void GameboyGPUFIFO::TickFetcher(const u8& _ly) {
+			fetcherDots++;
+
+			switch (fetcherState) {
+			case FETCH_TILE:
+				if (fetcherDots < 2) { break; }
+				fetcherDots = 0;
+
+				FetchTileNumber(_ly);
+				fetcherState = FETCH_DATA_LOW;
+				break;
+			case FETCH_DATA_LOW:
+				if (fetcherDots < 2) { break; }
+				fetcherDots = 0;
+
+				fetcherDataLow = FetchTileData(0);
+				fetcherState = FETCH_DATA_HIGH;
+				break;
+			case FETCH_DATA_HIGH:
+				if (fetcherDots < 2) { break; }
+				fetcherDots = 0;
+
+				fetcherDataHigh = FetchTileData(1);
+				fetcherState = FETCH_PUSH;
+				break;
+			case FETCH_PUSH:
+				fetcherDots = 0;
+
+				if (fetcherDummy) {
+					fetcherDummy = false;
+					fetcherState = FETCH_TILE;
+				} else if (bgFifoSize == 0) {
+					PushTile();
+					fetcherState = FETCH_TILE;
+				}
+				break;
+			}
+		}
+
+		void GameboyGPUFIFO::FetchTileNumber(const u8& _ly) {
+			auto mem_instance = m_MemInstance.lock();
+
+			int index;
+			int y;
+			if (fetcherWindow) {
+				y = windowLine;
+				index = graphicsCtx->win_tilemap_offset + ((y / PPU_TILE_SIZE_Y) * PPU_TILEMAP_SIZE_1D) + (fetcherX % PPU_TILEMAP_SIZE_1D);
+			} else {
+				// SCX and SCY get read for each tile, writes during mode 3 take effect with the next tile
+				int scx = mem_instance->GetIO(SCX_ADDR);
+				int scy = mem_instance->GetIO(SCY_ADDR);
+
+				y = ((int)_ly + scy) % PPU_TILEMAP_SIZE_1D_PIXELS;
+				index = graphicsCtx->bg_tilemap_offset + ((y / PPU_TILE_SIZE_Y) * PPU_TILEMAP_SIZE_1D) + (((scx / PPU_TILE_SIZE_X) + fetcherX) % PPU_TILEMAP_SIZE_1D);
+			}
+
+			fetcherTileNumber = graphicsCtx->VRAM_N[0][index];
+			fetcherTileAttr = cgbMode ? graphicsCtx->VRAM_N[1][index] : 0x00;
+
+			fetcherTileRow = y % PPU_TILE_SIZE_Y;
+			if (fetcherTileAttr & BG_ATTR_FLIP_VERTICAL) {
+				fetcherTileRow = (PPU_TILE_SIZE_Y - 1) - fetcherTileRow;
+			}
+		}
+
+		u8 GameboyGPUFIFO::FetchTileData(const int& _byte) {
+			int bank = (fetcherTileAttr & BG_ATTR_VRAM_BANK_CGB) ? 1 : 0;
+
+			int tile_sub_index;
+			if (graphicsCtx->bg_win_addr_mode_8000) {
+				tile_sub_index = (PPU_VRAM_BASEPTR_8000 - VRAM_N_OFFSET) + (fetcherTileNumber * 0x10);
+			} else {
+				tile_sub_index = (PPU_VRAM_BASEPTR_8800 - VRAM_N_OFFSET) + (*(i8*)&fetcherTileNumber * 0x10);
+			}
+			tile_sub_index += fetcherTileRow * PPU_TILE_SIZE_SCANLINE + _byte;
+
+			return graphicsCtx->VRAM_N[bank][tile_sub_index];
+		}
+
+		void GameboyGPUFIFO::PushTile() {
+			bool x_flip = (fetcherTileAttr & BG_ATTR_FLIP_HORIZONTAL) ? true : false;
+
+			for (int i = 0; i < PPU_TILE_SIZE_X; i++) {
+				int bit = x_flip ? i : 7 - i;
+
+				fifo_pixel& pixel = bgFifo[i];
+				pixel.color_index = (((fetcherDataHigh >> bit) & 0x01) << 1) | ((fetcherDataLow >> bit) & 0x01);
+				pixel.palette = fetcherTileAttr & BG_ATTR_PALETTE_CGB;
+				pixel.prio = (fetcherTileAttr & BG_ATTR_OAM_PRIORITY) ? true : false;
+				pixel.window = fetcherWindow;
+			}
+
+			bgFifoHead = 0;
+			bgFifoSize = PPU_TILE_SIZE_X;
+			fetcherX++;
+		}
+
+		void GameboyGPUFIFO::TickObjectFetch(const u8& _ly) {
+			if (--objFetchDots > 0) { return; }
+
+			const fifo_object& object = lineObjects[nextObject++];
+
+			int y_pos = (int)graphicsCtx->OAM[object.oam_offset + OBJ_ATTR_Y];
+			u8 tile_offset = graphicsCtx->OAM[object.oam_offset + OBJ_ATTR_INDEX];
+			u8 flags = graphicsCtx->OAM[object.oam_offset + OBJ_ATTR_FLAGS];
+
+			bool prio = (flags & OBJ_ATTR_PRIO) ? true : false;
+			if ((prio && !presentObjPrio0Set) || (!prio && !presentObjPrio1Set)) { return; }
+
+			int height = graphicsCtx->obj_size_16 ? PPU_TILE_SIZE_Y_16 : PPU_TILE_SIZE_Y;
+			int row = (int)_ly - (y_pos - PPU_TILE_SIZE_Y_16);
+			if (flags & OBJ_ATTR_Y_FLIP) {
+				row = (height - 1) - row;
+			}
+			if (graphicsCtx->obj_size_16) {
+				tile_offset &= 0xFE;
+			}
+
+			int bank = (cgbMode && (flags & OBJ_ATTR_VRAM_BANK_CGB)) ? 1 : 0;
+			int tile_sub_index = (PPU_VRAM_BASEPTR_8000 - VRAM_N_OFFSET) + (tile_offset * 0x10) + row * PPU_TILE_SIZE_SCANLINE;
+			u8 data_low = graphicsCtx->VRAM_N[bank][tile_sub_index];
+			u8 data_high = graphicsCtx->VRAM_N[bank][tile_sub_index + 1];
+
+			u8 palette;
+			if (cgbMode) {
+				palette = flags & OBJ_ATTR_PALETTE_CGB;
+			} else {
+				palette = (flags & OBJ_ATTR_PALETTE_DMG) ? 1 : 0;
+			}
+
+			bool x_flip = (flags & OBJ_ATTR_X_FLIP) ? true : false;
+
+			for (int i = 0; i < PPU_TILE_SIZE_X; i++) {
+				// pixels left of the current one (objects partially left of the screen) are lost
+				int slot = (object.x_pos - PPU_TILE_SIZE_X + i) - pixelX;
+				if (slot < 0 || slot >= PPU_TILE_SIZE_X) { continue; }
+
+				int bit = x_flip ? i : 7 - i;
+				u8 color_index = (((data_high >> bit) & 0x01) << 1) | ((data_low >> bit) & 0x01);
+				if (color_index == 0) { continue; }
+
+				// DMG: the object fetched first (smaller x, then OAM position) wins, CGB: the smaller OAM position wins
+				fifo_pixel& pixel = objFifo[(objFifoHead + slot) % PPU_TILE_SIZE_X];
+				if (pixel.color_index == 0 || (cgbMode && object.oam_offset < pixel.oam_offset)) {
+					pixel.color_index = color_index;
+					pixel.palette = palette;
+					pixel.prio = prio;
+					pixel.oam_offset = object.oam_offset;
+				}
+			}
+		}
+
+		void GameboyGPUFIFO::ShiftPixel(const u8& _ly) {
+			if (bgFifoSize == 0) { return; }
+
+			if (!fetcherWindow && drawWindow && graphicsCtx->win_enable && discardPixels == 0 &&
+				pixelX + 7 >= (int)m_MemInstance.lock()->GetIO(WX_ADDR)) {
+				StartWindow();
+				return;
+			}
+
+			fifo_pixel bg_pixel = bgFifo[bgFifoHead];
+			bgFifoHead++;
+			bgFifoSize--;
+
+			if (discardPixels > 0) {
+				discardPixels--;
+				return;
+			}
+
+			fifo_pixel obj_pixel = objFifo[objFifoHead];
+			objFifo[objFifoHead] = {};
+			objFifoHead = (objFifoHead + 1) % PPU_TILE_SIZE_X;
+
+			WritePixel(pixelX, _ly, MixPixel(bg_pixel, obj_pixel));
+			pixelX++;
+		}
+
+		void GameboyGPUFIFO::StartWindow() {
+			fetcherWindow = true;
+			windowLineDrawn = true;
+
+			fetcherState = FETCH_TILE;
+			fetcherDots = 0;
+			fetcherX = 0;
+
+			bgFifoHead = 0;
+			bgFifoSize = 0;
+
+			// WX < 7 moves the window out at the left edge
+			int wx = (int)m_MemInstance.lock()->GetIO(WX_ADDR);
+			if (wx < 7) {
+				discardPixels = 7 - wx;
+			}
+		}
+
+		u32 GameboyGPUFIFO::MixPixel(const fifo_pixel& _bg, const fifo_pixel& _obj) const {
+			int bg_color_index = _bg.color_index;
+			u32 bg_color;
+
+			if (cgbMode) {
+				bg_color = graphicsCtx->cgb_bgp_color_palettes[_bg.palette][bg_color_index];
+			} else if (graphicsCtx->bg_win_enable) {
+				bg_color = graphicsCtx->dmg_bgp_color_palette[bg_color_index];
+			} else {
+				bg_color_index = 0;
+				bg_color = colorWhite;
+			}
+
+			if ((_bg.window && !presentWindowSet) || (!_bg.window && !presentBackgroundSet)) {
+				bg_color_index = 0;
+				bg_color = colorWhite;
+			}
+
+			if (_obj.color_index != 0 && graphicsCtx->obj_enable) {
+				bool bg_over_obj;
+				if (cgbMode) {
+					// LCDC.0 removes the priority of BG and window in CGB mode
+					bg_over_obj = graphicsCtx->obj_prio && bg_color_index != 0 && (_bg.prio || _obj.prio);
+				} else {
+					bg_over_obj = _obj.prio && bg_color_index != 0;
+				}
+
+				if (!bg_over_obj) {
+					if (cgbMode) {
+						return graphicsCtx->cgb_obp_color_palettes[_obj.palette][_obj.color_index];
+					} else {
+						return _obj.palette ? graphicsCtx->dmg_obp1_color_palette[_obj.color_index] : graphicsCtx->dmg_obp0_color_palette[_obj.color_index];
+					}
+				}
+			}
+
+			return bg_color;
+		}
+
+		void GameboyGPUFIFO::WritePixel(const int& _x, const u8& _ly, const u32& _color) {
+			if (!renderFrame) { return; }
+			StorePixel(&imageData[((int)_ly * PPU_SCREEN_X + _x) * pixelSize], _color);
+		}
+	}
+}
\ No newline at end of file
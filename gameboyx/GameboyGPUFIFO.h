@@ -0,0 +1,134 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Dot based PPU engine which emulates the pixel FIFOs and the tile fetcher of the original hardware instead of
+*	drawing a whole scanline at once. Mode 3 therefore takes a variable amount of dots (SCX, window, objects) and
+*	register writes during mode 3 take effect at the exact pixel. Mode 2, 0 and 1 are shared with GameboyGPU.
+*	Slower than the scanline engine, so it gets only used for games which have it enabled.
+*/
+
+#include "GameboyGPU.h"
+
+namespace Emulation {
+	namespace Gameboy {
+		enum fetcher_state {
+			FETCH_TILE,
+			FETCH_DATA_LOW,
+			FETCH_DATA_HIGH,
+			FETCH_PUSH
+		};
+
+		struct fifo_pixel {
+			u8 color_index = 0;
+			u8 palette = 0;
+			bool prio = false;			// BG: CGB attribute priority, OBJ: BG over OBJ
+			int oam_offset = OAM_SIZE;	// OBJ only, CGB resolves overlapping objects by OAM position
+			bool window = false;		// BG only
+		};
+
+		struct fifo_object {
+			int oam_offset = 0;
+			int x_pos = 0;
+		};
+
+		// mode 3 can be in progress at the end of a RunCycles call, the FIFOs and the fetcher are part of the state
+		struct fifo_state {
+			fifo_pixel bg_fifo[PPU_TILE_SIZE_X];
+			int bg_fifo_head = 0;
+			int bg_fifo_size = 0;
+			fifo_pixel obj_fifo[PPU_TILE_SIZE_X];
+			int obj_fifo_head = 0;
+
+			fetcher_state fetcher = FETCH_TILE;
+			int fetcher_dots = 0;
+			int fetcher_x = 0;
+			bool fetcher_window = false;
+			bool fetcher_dummy = false;
+			u8 fetcher_tile_number = 0;
+			u8 fetcher_tile_attr = 0;
+			int fetcher_tile_row = 0;
+			u8 fetcher_data_low = 0;
+			u8 fetcher_data_high = 0;
+
+			fifo_object line_objects[PPU_OBJ_PER_SCANLINE];
+			int num_line_objects = 0;
+			int next_object = 0;
+			int obj_fetch_dots = 0;
+
+			int pixel_x = 0;
+			int discard_pixels = 0;
+
+			int window_line = 0;
+			bool window_line_drawn = false;
+		};
+
+		class GameboyGPUFIFO : public GameboyGPU {
+		public:
+			// constructor
+			GameboyGPUFIFO(std::shared_ptr<BaseCartridge> _cartridge);
+			~GameboyGPUFIFO() override = default;
+
+			void SaveState() override;
+			void RestoreState() override;
+
+			// members
+			void ProcessGPU(const int& _ticks) override;
+
+			void SetRenderThreadEnable(const bool& _enable) override;
+			void GetHardwareInfo(std::vector<data_entry>& _hardware_info) const override;
+
+		private:
+			void EnterMode3() override;
+			void TickMode3(const u8& _ly);
+
+			void TickFetcher(const u8& _ly);
+			void FetchTileNumber(const u8& _ly);
+			u8 FetchTileData(const int& _byte);
+			void PushTile();
+
+			void TickObjectFetch(const u8& _ly);
+			void ShiftPixel(const u8& _ly);
+			void StartWindow();
+
+			u32 MixPixel(const fifo_pixel& _bg, const fifo_pixel& _obj) const;
+			void WritePixel(const int& _x, const u8& _ly, const u32& _color);
+
+			// background/window FIFO, a new tile gets only pushed when empty
+			fifo_pixel bgFifo[PPU_TILE_SIZE_X];
+			int bgFifoHead = 0;
+			int bgFifoSize = 0;
+
+			// object FIFO, slot i holds the object pixel for the i-th pixel after the current one
+			fifo_pixel objFifo[PPU_TILE_SIZE_X];
+			int objFifoHead = 0;
+
+			// fetcher
+			fetcher_state fetcherState = FETCH_TILE;
+			int fetcherDots = 0;
+			int fetcherX = 0;
+			bool fetcherWindow = false;
+			bool fetcherDummy = false;
+			u8 fetcherTileNumber = 0;
+			u8 fetcherTileAttr = 0;
+			int fetcherTileRow = 0;
+			u8 fetcherDataLow = 0;
+			u8 fetcherDataHigh = 0;
+
+			// objects of the current line ordered by x position
+			fifo_object lineObjects[PPU_OBJ_PER_SCANLINE];
+			int numLineObjects = 0;
+			int nextObject = 0;
+			int objFetchDots = 0;
+
+			int pixelX = 0;
+			int discardPixels = 0;
+
+			int windowLine = 0;
+			bool windowLineDrawn = false;
+
+			fifo_state savedFifoState = fifo_state();
+		};
+	}
+}
\ No newline at end of file
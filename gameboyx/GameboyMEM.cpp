@@ -1,11 +1,13 @@
 #include "GameboyMEM.h"
+#include "Machine.h"
 
 #include "gameboy_defines.h"
 #include "logger.h"
 #include "format"
 #include "GameboyGPU.h"
 #include "GameboyCPU.h"
-#include "BaseAPU.h"
+#include "GameboyCTRL.h"
+#include "GameboyAPU.h"
 
 #include <iostream>
 
@@ -22,7 +24,7 @@ namespace Emulation {
             CONSTRUCTOR
         *********************************************************************************************************** */
         GameboyMEM::GameboyMEM(std::shared_ptr<BaseCartridge> _cartridge) {
-            machineCtx.battery_buffered = _cartridge->batteryBuffered;
+            machineCtx.battery_buffered = _cartridge->batteryBuffered && _cartridge->persistentSave;
             machineCtx.ram_present = _cartridge->ramPresent;
             machineCtx.timer_present = _cartridge->timerPresent;
 
@@ -59,7 +61,66 @@ namespace Emulation {
             }
         }
 
-        void GameboyMEM::Init() {}
+        void GameboyMEM::Init(const Machine& _machine) {
+            m_CoreInstance = std::dynamic_pointer_cast<GameboyCPU>(_machine.GetCore());
+            m_GraphicsInstance = std::dynamic_pointer_cast<GameboyGPU>(_machine.GetGraphics());
+            m_ControlInstance = std::dynamic_pointer_cast<GameboyCTRL>(_machine.GetControl());
+            m_SoundInstance = std::dynamic_pointer_cast<GameboyAPU>(_machine.GetSound());
+            profiler = _machine.GetProfiler().get();
+        }
+
+        /* ***********************************************************************************************************
+            STATE
+        *********************************************************************************************************** */
+        void GameboyMEM::SaveState() {
+            savedState.RAM_N.resize(RAM_N.size());
+            for (size_t i = 0; i < RAM_N.size(); i++) {
+                savedState.RAM_N[i].assign(RAM_N[i], RAM_N[i] + RAM_N_SIZE);
+            }
+            savedState.WRAM_0 = WRAM_0;
+            savedState.WRAM_N = WRAM_N;
+            savedState.HRAM = HRAM;
+            savedState.IO = IO;
+
+            savedState.machine_ctx = machineCtx;
+            savedState.graphics_ctx = graphics_ctx;
+            savedState.sound_ctx = sound_ctx;
+            savedState.control_ctx = control_ctx;
+            savedState.serial_ctx = serial_ctx;
+        }
+
+        void GameboyMEM::RestoreState() {
+            for (size_t i = 0; i < RAM_N.size(); i++) {
+                memcpy(RAM_N[i], savedState.RAM_N[i].data(), RAM_N_SIZE);
+            }
+            WRAM_0 = savedState.WRAM_0;
+            WRAM_N = savedState.WRAM_N;
+            HRAM = savedState.HRAM;
+            IO = savedState.IO;
+
+            // the VRAM versions only ever increase: the render thread snapshot and the decoded tiles of the PPU are keyed
+            // by them and must not take the restored VRAM for the speculative one
+            auto& saved_versions = savedState.graphics_ctx.vram_block_versions;
+            for (size_t i = 0; i < saved_versions.size(); i++) {
+                for (size_t j = 0; j < saved_versions[i].size(); j++) {
+                    if (saved_versions[i][j] != graphics_ctx.vram_block_versions[i][j]) {
+                        saved_versions[i][j] = graphics_ctx.vram_block_versions[i][j] + 1;
+                    }
+                }
+            }
+            if (savedState.graphics_ctx.vram_version != graphics_ctx.vram_version) {
+                savedState.graphics_ctx.vram_version = graphics_ctx.vram_version + 1;
+            }
+
+            machineCtx = savedState.machine_ctx;
+            graphics_ctx = savedState.graphics_ctx;
+            sound_ctx = savedState.sound_ctx;
+            control_ctx = savedState.control_ctx;
+            serial_ctx = savedState.serial_ctx;
+
+            // the object bins of the PPU aren't part of the state
+            graphics_ctx.oam_dirty = true;
+        }
 
         /* ***********************************************************************************************************
             HARDWARE ACCESS
@@ -133,9 +194,6 @@ namespace Emulation {
             }
 
             machineCtx.boot_rom_mapped = false;
-            if (machineCtx.cgb_compatibility) {
-                std::dynamic_pointer_cast<GameboyGPU>(BaseGPU::s_GetInstance())->SetHardwareMode(GB);
-            }
             return true;
         }
 
@@ -165,8 +223,10 @@ namespace Emulation {
             }
 
             graphics_ctx.VRAM_N = vector<vector<u8>>(machineCtx.vram_bank_num);
+            graphics_ctx.vram_block_versions = vector<vector<u32>>(machineCtx.vram_bank_num);
             for (int i = 0; i < machineCtx.vram_bank_num; i++) {
                 graphics_ctx.VRAM_N[i] = vector<u8>(VRAM_N_SIZE, 0);
+                graphics_ctx.vram_block_versions[i] = vector<u32>(VRAM_N_SIZE / PPU_VRAM_TILE_SIZE, 0);
             }
 
             if (machineCtx.ram_present && machineCtx.ram_bank_num > 0) {
@@ -200,7 +260,7 @@ namespace Emulation {
                 } else {
                     RAM_N = vector<u8*>(machineCtx.ram_bank_num);
                     for (int i = 0; i < machineCtx.ram_bank_num; i++) {
-                        RAM_N[i] = new u8[RAM_N_SIZE];
+                        RAM_N[i] = new u8[RAM_N_SIZE]();
                     }
                 }
             }
@@ -363,6 +423,7 @@ namespace Emulation {
                 return;
             } else {
                 graphics_ctx.VRAM_N[machineCtx.vram_bank_selected][_addr - VRAM_N_OFFSET] = _data;
+                MarkVRAMWrite(machineCtx.vram_bank_selected, _addr - VRAM_N_OFFSET, 1);
             }
         }
 
@@ -383,6 +444,7 @@ namespace Emulation {
                 return;
             } else {
                 graphics_ctx.OAM[_addr - OAM_OFFSET] = _data;
+                graphics_ctx.oam_dirty = true;
             }
         }
 
@@ -457,6 +519,11 @@ namespace Emulation {
             case CGB_HDMA4_ADDR:
                 return 0xFF;
                 break;
+            case JOYP_ADDR:
+                // late latch: the game sees the host input of the moment it reads the register
+                m_ControlInstance.lock()->LatchInput();
+                return IO[JOYP_ADDR - IO_OFFSET];
+                break;
             default:
                 if (_addr > 0xFF77) {
                     return 0xFF;
@@ -518,6 +585,7 @@ namespace Emulation {
                 break;
             case LCDC_ADDR:
                 SetLCDCValues(_data);
+                LogRegisterWrite(_addr, _data);
                 break;
             case STAT_ADDR:
                 SetLCDSTATValues(_data);
@@ -539,16 +607,19 @@ namespace Emulation {
             case BGP_ADDR:
                 IO[BGP_ADDR - IO_OFFSET] = _data;
                 SetColorPaletteValues(_data, graphics_ctx.dmg_bgp_color_palette, graphics_ctx.cgb_bgp_color_palettes[0]);
+                LogRegisterWrite(_addr, _data, graphics_ctx.dmg_bgp_color_palette);
                 break;
                 // DMG only
             case OBP0_ADDR:
                 IO[OBP0_ADDR - IO_OFFSET] = _data;
                 SetColorPaletteValues(_data, graphics_ctx.dmg_obp0_color_palette, graphics_ctx.cgb_obp_color_palettes[0]);
+                LogRegisterWrite(_addr, _data, graphics_ctx.dmg_obp0_color_palette);
                 break;
             case OBP1_ADDR:
                 // DMG only
                 IO[OBP1_ADDR - IO_OFFSET] = _data;
                 SetColorPaletteValues(_data, graphics_ctx.dmg_obp1_color_palette, graphics_ctx.cgb_obp_color_palettes[1]);
+                LogRegisterWrite(_addr, _data, graphics_ctx.dmg_obp1_color_palette);
                 break;
             case BANK_ADDR:
                 if (machineCtx.boot_rom_mapped) {
@@ -569,6 +640,13 @@ namespace Emulation {
                 break;
             case LY_ADDR:
                 break;
+            case SCX_ADDR:
+            case SCY_ADDR:
+            case WX_ADDR:
+            case WY_ADDR:
+                IO[_addr - IO_OFFSET] = _data;
+                LogRegisterWrite(_addr, _data);
+                break;
             case NR52_ADDR:
                 SetAPUMasterControl(_data);
                 break;
@@ -641,6 +719,10 @@ namespace Emulation {
                 }
                 break;
             }
+
+            if (NR10_ADDR - 1 < _addr && _addr < WAVE_RAM_ADDR + WAVE_RAM_SIZE) {
+                m_SoundInstance.lock()->UpdateChannelOutputs();
+            }
         }
 
         u8& GameboyMEM::GetIO(const u16& _addr) {
@@ -681,6 +763,17 @@ namespace Emulation {
             }
         }
 
+        // keeps track of changed VRAM for the renderer, called for every write to VRAM (CPU and DMA)
+        void GameboyMEM::MarkVRAMWrite(const int& _bank, const u16& _offset, const int& _length) {
+            graphics_ctx.vram_version++;
+
+            auto& versions = graphics_ctx.vram_block_versions[_bank];
+            int last_block = std::min((_offset + _length - 1) / PPU_VRAM_TILE_SIZE, (int)versions.size() - 1);
+            for (int i = _offset / PPU_VRAM_TILE_SIZE; i <= last_block; i++) {
+                versions[i]++;
+            }
+        }
+
         /* ***********************************************************************************************************
             DMA
         *********************************************************************************************************** */
@@ -702,11 +795,11 @@ namespace Emulation {
 
                 graphics_ctx.vram_dma_ppu_en = graphics_ctx.ppu_enable;
 
-                auto m_CoreInstance = std::dynamic_pointer_cast<GameboyCPU>(BaseCPU::s_GetInstance());
+                auto core_instance = m_CoreInstance.lock();
 
                 if (_data & 0x80) {
                     // HBLANK DMA
-                    m_CoreInstance->TickTimers();
+                    core_instance->TickTimers();
 
                     if (source_addr < ROM_N_OFFSET) {
                         graphics_ctx.vram_dma_src_addr = source_addr;
@@ -735,18 +828,19 @@ namespace Emulation {
                     graphics_ctx.vram_dma = true;
 
                     if (graphics_ctx.mode == PPU_MODE_0 || !graphics_ctx.ppu_enable) {
-                        std::dynamic_pointer_cast<GameboyGPU>(BaseGPU::s_GetInstance())->VRAMDMANextBlock();
+                        m_GraphicsInstance.lock()->VRAMDMANextBlock();
                     }
 
                     //LOG_WARN("VRAM HBLANK DMA: ", graphics_ctx.dma_length * 0x10);
                 } else {
-                    // General purpose DMA
+                    // General purpose DMA, the PPU and APU time of the stalled cycles counts to them
+                    ProfileScope profile_scope(profiler, PROFILE_DMA);
                     u8 blocks = (IO[CGB_HDMA5_ADDR - IO_OFFSET] & 0x7F) + 1;
                     u16 length = (u16)blocks * 0x10;
 
                     int machine_cycles = ((int)blocks * VRAM_DMA_MC_PER_BLOCK * machineCtx.currentSpeed) + 1;
                     for (int i = 0; i < machine_cycles; i++) {
-                        m_CoreInstance->TickTimers();
+                        core_instance->TickTimers();
                     }
 
                     if (source_addr < ROM_N_OFFSET) {
@@ -765,6 +859,7 @@ namespace Emulation {
                     } else {
                         memcpy(&graphics_ctx.VRAM_N[machineCtx.vram_bank_selected][dest_addr], &RAM_N[machineCtx.ram_bank_selected][source_addr - (RAM_N_OFFSET + 0x4000)], length);
                     }
+                    MarkVRAMWrite(machineCtx.vram_bank_selected, dest_addr, length);
 
                     IO[CGB_HDMA5_ADDR - IO_OFFSET] = 0xFF;
                 }
@@ -774,8 +869,7 @@ namespace Emulation {
         void GameboyMEM::OAM_DMA(const u8& _data) {
             graphics_ctx.oam_dma = false;
     
-            auto m_CoreInstance = std::dynamic_pointer_cast<GameboyCPU>(BaseCPU::s_GetInstance());
-            m_CoreInstance->TickTimers();
+            m_CoreInstance.lock()->TickTimers();
 
             IO[OAM_DMA_ADDR - IO_OFFSET] = _data;
             u16 source_addr = (u16)IO[OAM_DMA_ADDR - IO_OFFSET] << 8;
@@ -934,10 +1028,10 @@ namespace Emulation {
             }
 
             // bit 2
-            if (_data & PPU_LCDC_OBJ_SIZE) {
-                graphics_ctx.obj_size_16 = true;
-            } else {
-                graphics_ctx.obj_size_16 = false;
+            bool obj_size_16 = (_data & PPU_LCDC_OBJ_SIZE) ? true : false;
+            if (obj_size_16 != graphics_ctx.obj_size_16) {
+                graphics_ctx.obj_size_16 = obj_size_16;
+                graphics_ctx.oam_dirty = true;
             }
 
             // bit 3
@@ -975,12 +1069,12 @@ namespace Emulation {
                 graphics_ctx.ppu_enable = false;
                 IO[LY_ADDR - IO_OFFSET] = 0x00;
 
-                auto m_GraphicsInstance = std::dynamic_pointer_cast<GameboyGPU>(BaseGPU::s_GetInstance());
+                auto graphics_instance = m_GraphicsInstance.lock();
 
-                m_GraphicsInstance->SetMode(PPU_MODE_2);
+                graphics_instance->SetMode(PPU_MODE_2);
 
                 if (graphics_ctx.vram_dma_ppu_en) {
-                    m_GraphicsInstance->VRAMDMANextBlock();
+                    graphics_instance->VRAMDMANextBlock();
                     graphics_ctx.vram_dma_ppu_en = false;             // needs to be investigated if this is correct, docs state that the block transfer happens when ppu was enabled when hdma started and ppu gets disabled afterwards
                 }
             }
@@ -1019,20 +1113,21 @@ namespace Emulation {
             u8 colors = _data;
 
             // TODO: CGB is able to set different color palettes for DMG games
+            // dmg_colors hold the shades in the output pixel format
             if (machineCtx.is_cgb) {
                 for (int i = 0; i < 4; i++) {
                     switch (colors & 0x03) {
                     case 0x00:
-                        _color_palette[i] = CGB_DMG_COLOR_WHITE;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_CGB][0];
                         break;
                     case 0x01:
-                        _color_palette[i] = CGB_DMG_COLOR_LIGHTGREY;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_CGB][1];
                         break;
                     case 0x02:
-                        _color_palette[i] = CGB_DMG_COLOR_DARKGREY;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_CGB][2];
                         break;
                     case 0x03:
-                        _color_palette[i] = CGB_DMG_COLOR_BLACK;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_CGB][3];
                         break;
                     }
 
@@ -1061,16 +1156,16 @@ namespace Emulation {
                 for (int i = 0; i < 4; i++) {
                     switch (colors & 0x03) {
                     case 0x00:
-                        _color_palette[i] = DMG_COLOR_WHITE_ALT;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_DMG][0];
                         break;
                     case 0x01:
-                        _color_palette[i] = DMG_COLOR_LIGHTGREY_ALT;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_DMG][1];
                         break;
                     case 0x02:
-                        _color_palette[i] = DMG_COLOR_DARKGREY_ALT;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_DMG][2];
                         break;
                     case 0x03:
-                        _color_palette[i] = DMG_COLOR_BLACK_ALT;
+                        _color_palette[i] = graphics_ctx.dmg_colors[DMG_COLORS_DMG][3];
                         break;
                     }
 
@@ -1079,6 +1174,19 @@ namespace Emulation {
             }
         }
 
+        // CGB palette RAM (BCPD/OCPD) is locked during mode 3, so only the DMG palettes, scrolling, window and LCDC end up here
+        void GameboyMEM::LogRegisterWrite(const u16& _addr, const u8& _data, const u32* _color_palette) {
+            if (graphics_ctx.ppu_enable && graphics_ctx.mode == PPU_MODE_3 && graphics_ctx.reg_writes_num < PPU_REG_WRITES_PER_LINE) {
+                ppu_register_write& reg_write = graphics_ctx.reg_writes[graphics_ctx.reg_writes_num++];
+                reg_write.dot = graphics_ctx.line_dots;
+                reg_write.addr = _addr;
+                reg_write.data = _data;
+                if (_color_palette != nullptr) {
+                    memcpy(reg_write.color_palette, _color_palette, sizeof(reg_write.color_palette));
+                }
+            }
+        }
+
         void GameboyMEM::SetBGWINPaletteValues(const u8& _data) {
             u8 addr = IO[BCPS_BGPI_ADDR - IO_OFFSET] & 0x3F;
 
@@ -1092,9 +1200,8 @@ namespace Emulation {
 
                 // NOTE: CGB has RGB555 in little endian -> reverse order
                 u16 rgb555_color = graphics_ctx.cgb_bgp_palette_ram[ram_index] | ((u16)graphics_ctx.cgb_bgp_palette_ram[ram_index + 1] << 8);
-                u32 rgba8888_color = ((u32)(rgb555_color & PPU_CGB_RED) << 27) | ((u32)(rgb555_color & PPU_CGB_GREEN) << 14) | ((u32)(rgb555_color & PPU_CGB_BLUE) << 1) | 0xFF;        // additionally leftshift each value by 3 -> 5 bit to 8 bit 'scaling'
 
-                graphics_ctx.cgb_bgp_color_palettes[palette_index][color_index] = rgba8888_color;
+                graphics_ctx.cgb_bgp_color_palettes[palette_index][color_index] = graphics_ctx.cgb_color_lut[rgb555_color & PPU_CGB_COLOR_MASK];
         
                 /*
                 LOG_WARN("------------");
@@ -1123,9 +1230,8 @@ namespace Emulation {
                 int color_index = (addr & 0x07) >> 1;
 
                 u16 rgb555_color = graphics_ctx.cgb_obp_palette_ram[ram_index] | ((u16)graphics_ctx.cgb_obp_palette_ram[ram_index + 1] << 8);
-                u32 rgba8888_color = ((u32)(rgb555_color & PPU_CGB_RED) << 27) | ((u32)(rgb555_color & PPU_CGB_GREEN) << 14) | ((u32)(rgb555_color & PPU_CGB_BLUE) << 1) | 0xFF;
 
-                graphics_ctx.cgb_obp_color_palettes[palette_index][color_index] = rgba8888_color;
+                graphics_ctx.cgb_obp_color_palettes[palette_index][color_index] = graphics_ctx.cgb_color_lut[rgb555_color & PPU_CGB_COLOR_MASK];
             }
 
             if (graphics_ctx.obp_increment) {
@@ -1177,8 +1283,8 @@ namespace Emulation {
             IO[NR51_ADDR - IO_OFFSET] = _data;
 
             for (u8 mask = 0x01; auto & n : sound_ctx.ch_ctxs) {
-                n.right.store(_data & mask ? true : false);
-                n.left.store(_data & (mask << 4) ? true : false);
+                n.right = _data & mask ? true : false;
+                n.left = _data & (mask << 4) ? true : false;
                 mask <<= 1;
             }
         }
@@ -1186,15 +1292,15 @@ namespace Emulation {
         void GameboyMEM::SetAPUMasterVolume(const u8& _data) {
             IO[NR50_ADDR - IO_OFFSET] = _data;
 
-            sound_ctx.masterVolumeRight.store((float)VOLUME_MAP.at(_data & MASTER_VOLUME_RIGHT));
-            sound_ctx.masterVolumeLeft.store((float)VOLUME_MAP.at((_data & MASTER_VOLUME_LEFT) >> 4));
-            sound_ctx.outRightEnabled.store(_data & 0x08 ? true : false);
-            sound_ctx.outLeftEnabled.store(_data & 0x80 ? true : false);
+            sound_ctx.masterVolumeRight = (float)VOLUME_MAP.at(_data & MASTER_VOLUME_RIGHT);
+            sound_ctx.masterVolumeLeft = (float)VOLUME_MAP.at((_data & MASTER_VOLUME_LEFT) >> 4);
+            sound_ctx.outRightEnabled = _data & 0x08 ? true : false;
+            sound_ctx.outLeftEnabled = _data & 0x80 ? true : false;
         }
 
         void GameboyMEM::SetAPUCh1Sweep(const u8& _data) {
             auto* ch_ctx = &sound_ctx.ch_ctxs[0];
-            auto* period_ctx = static_cast<ch_ext_period*>(ch_ctx->exts[PERIOD].get());
+            auto* period_ctx = &ch_ctx->sweep;
             IO[ch_ctx->regs.nrX0 - IO_OFFSET] = _data;
 
             period_ctx->sweep_pace = (_data & CH1_SWEEP_PACE) >> 4;
@@ -1203,27 +1309,26 @@ namespace Emulation {
         }
 
         void GameboyMEM::SetAPUCh12TimerDutyCycle(const u8& _data, channel_context* _ch_ctx) {
-            auto* pwm_ctx = static_cast<ch_ext_pwm*>(_ch_ctx->exts[PWM].get());
             IO[_ch_ctx->regs.nrX1 - IO_OFFSET] = _data;
 
-            pwm_ctx->duty_cycle_index.store((_data & CH_1_2_DUTY_CYCLE) >> 6);
+            _ch_ctx->duty_cycle_index = (_data & CH_1_2_DUTY_CYCLE) >> 6;
             _ch_ctx->length_timer = _data & CH_1_2_4_LENGTH_TIMER;
             _ch_ctx->length_altered = true;
         }
 
         void GameboyMEM::SetAPUCh124Envelope(const u8& _data, channel_context* _ch_ctx) {
-            auto* env_ctx = static_cast<ch_ext_envelope*>(_ch_ctx->exts[ENVELOPE].get());
+            auto* env_ctx = &_ch_ctx->envelope;
             IO[_ch_ctx->regs.nrX2 - IO_OFFSET] = _data;
 
             env_ctx->envelope_volume = (_data & CH_1_2_4_ENV_VOLUME) >> 4;
             env_ctx->envelope_increase = (_data & CH_1_2_4_ENV_DIR ? true : false);
             env_ctx->envelope_pace = _data & CH_1_2_4_ENV_PACE;
 
-            _ch_ctx->volume.store((float)env_ctx->envelope_volume / 0xF);
+            _ch_ctx->volume = (float)env_ctx->envelope_volume / 0xF;
 
             _ch_ctx->dac = _data & 0xF8 ? true : false;
             if (!_ch_ctx->dac) {
-                _ch_ctx->enable.store(false);
+                _ch_ctx->enable = false;
                 IO[NR52_ADDR - IO_OFFSET] &= ~_ch_ctx->enable_bit;
             }
         }
@@ -1232,20 +1337,18 @@ namespace Emulation {
             IO[_ch_ctx->regs.nrX3 - IO_OFFSET] = _data;
 
             _ch_ctx->period = _data | (((u16)IO[_ch_ctx->regs.nrX4 - IO_OFFSET] & CH_1_2_3_PERIOD_HIGH) << 8);
-            _ch_ctx->sampling_rate.store((float)(pow(2, 20) / (CH_1_2_3_PERIOD_FLIP - _ch_ctx->period)));
         }
 
         void GameboyMEM::SetAPUCh12PeriodHighControl(const u8& _data, channel_context* _ch_ctx) {
             IO[_ch_ctx->regs.nrX4 - IO_OFFSET] = _data;
 
             if (_data & CH_1_2_3_4_CTRL_TRIGGER && _ch_ctx->dac) {
-                _ch_ctx->enable.store(true);
+                _ch_ctx->enable = true;
                 IO[NR52_ADDR - IO_OFFSET] |= _ch_ctx->enable_bit;
             }
             _ch_ctx->length_enable = _data & CH_1_2_3_4_CTRL_LENGTH_EN ? true : false;
 
             _ch_ctx->period = (((u16)_data & CH_1_2_3_PERIOD_HIGH) << 8) | IO[_ch_ctx->regs.nrX3 - IO_OFFSET];
-            _ch_ctx->sampling_rate.store((float)(pow(2, 20) / (CH_1_2_3_PERIOD_FLIP - _ch_ctx->period)));
         }
 
         void GameboyMEM::SetAPUCh3DACEnable(const u8& _data) {
@@ -1254,7 +1357,7 @@ namespace Emulation {
 
             ch_ctx->dac = _data & CH_3_DAC ? true : false;
             if (!ch_ctx->dac) {
-                ch_ctx->enable.store(false);
+                ch_ctx->enable = false;
                 IO[NR52_ADDR - IO_OFFSET] &= ~CH_3_ENABLE;
             }
         }
@@ -1268,41 +1371,23 @@ namespace Emulation {
         }
 
         void GameboyMEM::SetAPUCh3Volume(const u8& _data) {
-            static int change_counter = 0;
-            static int prev_chunk_id = BaseAPU::s_GetInstance()->GetChunkId();
-            static int cur_chunk_id = prev_chunk_id;
-
             auto* ch_ctx = &sound_ctx.ch_ctxs[2];
             IO[NR32_ADDR - IO_OFFSET] = _data;
 
             switch (_data & CH_3_VOLUME) {
             case 0x00:
-                ch_ctx->volume.store(VOLUME_MAP.at(8));
+                ch_ctx->volume = VOLUME_MAP.at(8);
                 break;
             case 0x20:
-                ch_ctx->volume.store(VOLUME_MAP.at(7));
+                ch_ctx->volume = VOLUME_MAP.at(7);
                 break;
             case 0x40:
-                ch_ctx->volume.store(VOLUME_MAP.at(3));
+                ch_ctx->volume = VOLUME_MAP.at(3);
                 break;
             case 0x60:
-                ch_ctx->volume.store(VOLUME_MAP.at(1));
+                ch_ctx->volume = VOLUME_MAP.at(1);
                 break;
             }
-
-            if (ch_ctx->use_current_state) {
-                cur_chunk_id = BaseAPU::s_GetInstance()->GetChunkId();
-                if (cur_chunk_id != prev_chunk_id) {
-                    prev_chunk_id = cur_chunk_id;
-                    change_counter = 0;
-                }
-
-                ++change_counter;
-                if (change_counter > 1) {
-                    ch_ctx->use_current_state = false;
-                    change_counter = 0;
-                }
-            }
         }
 
         void GameboyMEM::SetAPUCh3PeriodLow(const u8& _data) {
@@ -1310,7 +1395,6 @@ namespace Emulation {
             IO[NR33_ADDR - IO_OFFSET] = _data;
 
             ch_ctx->period = _data | (((u16)IO[NR34_ADDR - IO_OFFSET] & CH_1_2_3_PERIOD_HIGH) << 8);
-            ch_ctx->sampling_rate.store((float)(pow(2, 21) / (CH_1_2_3_PERIOD_FLIP - ch_ctx->period)));
         }
 
         void GameboyMEM::SetAPUCh3PeriodHighControl(const u8& _data) {
@@ -1318,25 +1402,20 @@ namespace Emulation {
             IO[NR34_ADDR - IO_OFFSET] = _data;
 
             if (_data & CH_1_2_3_4_CTRL_TRIGGER && ch_ctx->dac) {
-                ch_ctx->enable.store(true);
+                ch_ctx->enable = true;
                 IO[NR52_ADDR - IO_OFFSET] |= CH_3_ENABLE;
             }
             ch_ctx->length_enable = _data & CH_1_2_3_4_CTRL_LENGTH_EN ? true : false;
 
             ch_ctx->period = (((u16)_data & CH_1_2_3_PERIOD_HIGH) << 8) | IO[NR33_ADDR - IO_OFFSET];
-            ch_ctx->sampling_rate.store((float)(pow(2, 21) / (CH_1_2_3_PERIOD_FLIP - ch_ctx->period)));
         }
 
         void GameboyMEM::SetAPUCh3WaveRam(const u16& _addr, const u8& _data) {
             IO[_addr - IO_OFFSET] = _data;
 
-            auto* ch_ctx = &sound_ctx.ch_ctxs[2];
-            auto* wave_ctx = static_cast<ch_ext_waveram*>(ch_ctx->exts[WAVE_RAM].get());
-
             int index = (_addr - WAVE_RAM_ADDR) << 1;
-            unique_lock<mutex> lock_wave_ram(wave_ctx->mut_wave_ram);
-            wave_ctx->wave_ram[index] = ((float)(_data >> 4) / 0x7) - 1.f;
-            wave_ctx->wave_ram[index + 1] = ((float)(_data & 0xF) / 0x7) - 1.f;
+            sound_ctx.wave_ram[index] = ((float)(_data >> 4) / 0x7) - 1.f;
+            sound_ctx.wave_ram[index + 1] = ((float)(_data & 0xF) / 0x7) - 1.f;
         }
 
         void GameboyMEM::SetAPUCh4Timer(const u8& _data) {
@@ -1351,27 +1430,25 @@ namespace Emulation {
             IO[NR43_ADDR - IO_OFFSET] = _data;
 
             auto* ch_ctx = &sound_ctx.ch_ctxs[3];
-            auto* lfsr_ctx = static_cast<ch_ext_lfsr*>(ch_ctx->exts[LFSR].get());
+            auto* lfsr_ctx = &ch_ctx->lfsr;
 
             lfsr_ctx->lfsr_width_7bit = _data & CH_4_LFSR_WIDTH ? true : false;
 
+            // LFSR clock: 2^18 / (divider * 2^shift) Hz with divider 0 treated as .5
             int ch4_clock_shift = (_data & CH_4_CLOCK_SHIFT) >> 4;
             int t = _data & CH_4_CLOCK_DIVIDER;
-            float ch4_clock_divider = t ? (float)t : .5f;
-            ch_ctx->sampling_rate.store((float)(pow(2, 18) / (ch4_clock_divider * pow(2, ch4_clock_shift))));
-
-            lfsr_ctx->lfsr_step = (float)(ch_ctx->sampling_rate.load() / BASE_CLOCK_CPU);
+            lfsr_ctx->clock_ticks = (t ? t * CH_4_LFSR_CLOCK_TICKS_PER_DIV : CH_4_LFSR_CLOCK_TICKS_MIN) << ch4_clock_shift;
         }
 
         void GameboyMEM::SetAPUCh4Control(const u8& _data) {
             IO[NR44_ADDR - IO_OFFSET] = _data;
 
             auto* ch_ctx = &sound_ctx.ch_ctxs[3];
-            auto* lfsr_ctx = static_cast<ch_ext_lfsr*>(ch_ctx->exts[LFSR].get());
+            auto* lfsr_ctx = &ch_ctx->lfsr;
 
             if (_data & CH_1_2_3_4_CTRL_TRIGGER && ch_ctx->dac) {
                 lfsr_ctx->lfsr = CH_4_LFSR_INIT_VALUE;
-                ch_ctx->enable.store(true);
+                ch_ctx->enable = true;
                 IO[NR52_ADDR - IO_OFFSET] |= CH_4_ENABLE;
             }
             ch_ctx->length_enable = _data & CH_1_2_3_4_CTRL_LENGTH_EN ? true : false;
@@ -59,10 +59,24 @@ namespace Emulation {
 			bool boot_rom_mapped = false;
 		};
 
+		// register write during mode 3, gets applied by the scanline renderer at the corresponding pixel
+		struct ppu_register_write {
+			int dot = 0;
+			u16 addr = 0;
+			u8 data = 0;
+			u32 color_palette[4] = {};		// resulting colors for BGP, OBP0 and OBP1
+		};
+
 		struct graphics_context {
 			// VRAM/OAM
 			std::vector<std::vector<u8>> VRAM_N;
 			std::vector<u8> OAM;
+			// incremented on every VRAM write, lets the renderer detect changes
+			u32 vram_version = 0;
+			// write counters per 16 byte block (one tile or 16 tilemap entries) of each bank
+			std::vector<std::vector<u32>> vram_block_versions;
+			// set on OAM writes, OAM DMA and object size changes, the PPU rebuilds its per line object lists
+			bool oam_dirty = true;
 
 			bool vblank_if_write = false;
 
@@ -103,6 +117,16 @@ namespace Emulation {
 			// bit 6
 			bool lyc_ly_int_sel = false;
 
+			// dots into the current scanline (updated by the PPU during mode 3) and the writes made during mode 3
+			int line_dots = 0;
+			ppu_register_write reg_writes[PPU_REG_WRITES_PER_LINE];
+			int reg_writes_num = 0;
+
+			// DMG shades for DMG (ALT) and CGB hardware, converted to the output pixel format by the PPU
+			u32 dmg_colors[2][4] = {
+				{DMG_COLOR_WHITE_ALT, DMG_COLOR_LIGHTGREY_ALT, DMG_COLOR_DARKGREY_ALT, DMG_COLOR_BLACK_ALT},
+				{CGB_DMG_COLOR_WHITE, CGB_DMG_COLOR_LIGHTGREY, CGB_DMG_COLOR_DARKGREY, CGB_DMG_COLOR_BLACK}
+			};
 			u32 dmg_bgp_color_palette[4];
 			u32 dmg_obp0_color_palette[4];
 			u32 dmg_obp1_color_palette[4];
@@ -116,6 +140,9 @@ namespace Emulation {
 			u8 cgb_obp_palette_ram[PPU_PALETTE_RAM_SIZE_CGB] = {};
 			u8 cgb_bgp_palette_ram[PPU_PALETTE_RAM_SIZE_CGB] = {};
 
+			// BGR555 -> output color, selected table of the PPU (raw or LCD color corrected)
+			const u32* cgb_color_lut = nullptr;
+
 			u32 cgb_obp_color_palettes[8][4] = {
 				{CGB_DMG_COLOR_WHITE, CGB_DMG_COLOR_WHITE, CGB_DMG_COLOR_WHITE, CGB_DMG_COLOR_WHITE},
 				{CGB_DMG_COLOR_WHITE, CGB_DMG_COLOR_WHITE, CGB_DMG_COLOR_WHITE, CGB_DMG_COLOR_WHITE},
@@ -179,76 +206,39 @@ namespace Emulation {
 			{}
 		};
 
-		enum CH_EXT_TYPE {
-			ENVELOPE,
-			PERIOD,
-			PWM,
-			WAVE_RAM,
-			LFSR
-		};
-
-		struct ch_extension {
-			virtual ~ch_extension() {};
-		};
-
-		struct ch_ext_envelope : ch_extension {
-			int envelope_volume = 0;							// envelope NR12, NR22, ...
+		// fixed feature slots of a channel, only used by the channels which have the feature
+		struct ch_envelope {
+			int envelope_volume = 0;							// envelope NR12, NR22, NR42
 			bool envelope_increase = false;
 			int envelope_pace = 0;
-
-			~ch_ext_envelope() = default;
 		};
 
-		struct ch_ext_period : ch_extension {
+		struct ch_sweep {
 			int sweep_pace = 0;									// sweep NR10
 			bool sweep_dir_subtract = false;
 			int sweep_period_step = 0;
-
-			~ch_ext_period() = default;
-		};
-
-		struct ch_ext_pwm : ch_extension {
-			alignas(64) std::atomic<int> duty_cycle_index = 0;
-
-			~ch_ext_pwm() = default;
-		};
-
-		struct ch_ext_waveram : ch_extension {
-			std::mutex mut_wave_ram;							// wave RAM
-			float wave_ram[32] = {
-				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f,
-				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f,
-				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f,
-				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f
-			};
-			int sample_tick_count = 0;
-
-			~ch_ext_waveram() = default;
 		};
 
-		struct ch_ext_lfsr : ch_extension {
+		struct ch_lfsr {
 			bool lfsr_width_7bit = false;						// frequency and randomness NR43
 			u16 lfsr = CH_4_LFSR_INIT_VALUE;
-			float lfsr_step = .0f;
-
-			~ch_ext_lfsr() = default;
+			int clock_ticks = CH_4_LFSR_CLOCK_TICKS_MIN;
 		};
 
+		// flat channel state, owned by the emulation thread (the audio thread only receives mixed frames)
 		struct channel_context {
 			ch_registers regs;
 
-			alignas(64) std::atomic<bool> enable = false;		// set by APU
+			bool enable = false;								// set by APU
 
-			alignas(64) std::atomic<bool> right = false;		// channel panning	NR51
-			alignas(64) std::atomic<bool> left = false;
+			bool right = false;									// channel panning	NR51
+			bool left = false;
 
 			int length_timer = 0;								// length NR11, NR21, ...
 			bool length_altered = false;
 			bool length_enable = false;							// ctrl NR14, ...
 
-			alignas(64) std::atomic<float> volume = .0f;
-
-			alignas(64) std::atomic<float> sampling_rate = 1.f;
+			float volume = .0f;
 
 			bool dac = false;
 
@@ -256,35 +246,28 @@ namespace Emulation {
 
 			int period = 0;
 
-			bool use_current_state = true;
-
-			std::unordered_map<CH_EXT_TYPE, std::unique_ptr<ch_extension>> exts;
+			int duty_cycle_index = 0;							// channel 1, 2
+			ch_envelope envelope;								// channel 1, 2, 4
+			ch_sweep sweep;										// channel 1
+			ch_lfsr lfsr;										// channel 4
 
 			channel_context() {};
 			channel_context(int _channel) {
 				switch (_channel) {
 				case 1:
 					regs = ch_registers(NR10_ADDR, NR11_ADDR, NR12_ADDR, NR13_ADDR, NR14_ADDR);
-					exts[ENVELOPE]	= std::unique_ptr<ch_extension>(new ch_ext_envelope());
-					exts[PERIOD]	= std::unique_ptr<ch_extension>(new ch_ext_period());
-					exts[PWM]		= std::unique_ptr<ch_extension>(new ch_ext_pwm());
 					enable_bit = CH_1_ENABLE;
 					break;
 				case 2:
 					regs = ch_registers(NR21_ADDR, NR22_ADDR, NR23_ADDR, NR24_ADDR);
-					exts[ENVELOPE]	= std::unique_ptr<ch_extension>(new ch_ext_envelope());
-					exts[PWM]		= std::unique_ptr<ch_extension>(new ch_ext_pwm());
 					enable_bit = CH_2_ENABLE;
 					break;
 				case 3:
 					regs = ch_registers(NR30_ADDR, NR31_ADDR, NR32_ADDR, NR33_ADDR, NR34_ADDR);
-					exts[WAVE_RAM]	= std::unique_ptr<ch_extension>(new ch_ext_waveram());
 					enable_bit = CH_3_ENABLE;
 					break;
 				case 4:
 					regs = ch_registers(NR41_ADDR, NR42_ADDR, NR43_ADDR, NR44_ADDR);
-					exts[ENVELOPE]	= std::unique_ptr<ch_extension>(new ch_ext_envelope());
-					exts[LFSR]		= std::unique_ptr<ch_extension>(new ch_ext_lfsr());
 					enable_bit = CH_4_ENABLE;
 					break;
 				default:
@@ -293,18 +276,16 @@ namespace Emulation {
 			};
 		};
 
-
 		struct sound_context {
 			// master control	NR52
 			bool apuEnable = true;					// set by CPU
 
 			// master Volume	NR50
-			alignas(64) std::atomic<float> masterVolumeRight = 1.f;
-			alignas(64) std::atomic<float> masterVolumeLeft = 1.f;
-			alignas(64) std::atomic<bool> outRightEnabled = true;
-			alignas(64) std::atomic<bool> outLeftEnabled = true;
+			float masterVolumeRight = 1.f;
+			float masterVolumeLeft = 1.f;
+			bool outRightEnabled = true;
+			bool outLeftEnabled = true;
 
-			// stack allocated array of channel contexts
 			channel_context ch_ctxs[4] = {
 				channel_context(1),
 				channel_context(2),
@@ -312,7 +293,13 @@ namespace Emulation {
 				channel_context(4)
 			};
 
-			~sound_context() {}
+			// channel 3 wave RAM
+			float wave_ram[32] = {
+				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f,
+				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f,
+				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f,
+				.0f, .0f, .0f, .0f, .0f, .0f, .0f, .0f
+			};
 		};
 
 		struct control_context {
@@ -342,13 +329,35 @@ namespace Emulation {
 			u8 div_bit = SERIAL_NORMAL_SPEED_BIT;
 		};
 
+		// RAM and the register contexts, ROM and the memory tables never change while running
+		struct mem_state {
+			std::vector<std::vector<u8>> RAM_N;
+			std::vector<u8> WRAM_0;
+			std::vector<std::vector<u8>> WRAM_N;
+			std::vector<u8> HRAM;
+			std::vector<u8> IO;
+
+			machine_context machine_ctx = machine_context();
+			graphics_context graphics_ctx = graphics_context();
+			sound_context sound_ctx = sound_context();
+			control_context control_ctx = control_context();
+			serial_context serial_ctx = serial_context();
+		};
+
+		class GameboyCPU;
+		class GameboyGPU;
+		class GameboyCTRL;
+		class GameboyAPU;
+
 		class GameboyMEM : public BaseMEM {
 		public:
 			friend class BaseMEM;
 			// constructor
 			explicit GameboyMEM(std::shared_ptr<BaseCartridge> _cartridge);
 			virtual ~GameboyMEM() override;
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			// clone/assign protection
 			//GameboyMEM(GameboyMEM const&) = delete;
@@ -394,6 +403,7 @@ namespace Emulation {
 			void UnsetButton(const u8& _bit, const bool& _is_button);
 
 			const u8* GetBank(const MEM_TYPE& _type, const int& _bank);
+			void MarkVRAMWrite(const int& _bank, const u16& _offset, const int& _length);
 
 			// actual memory
 			std::vector<u8> ROM_0;
@@ -439,6 +449,7 @@ namespace Emulation {
 			void SetObjPrio(const u8& _data);
 
 			void SetColorPaletteValues(const u8& _data, u32* _color_palette, u32* _source_palette);
+			void LogRegisterWrite(const u16& _addr, const u8& _data, const u32* _color_palette = nullptr);
 
 			void SetBGWINPaletteValues(const u8& _data);
 			void SetOBJPaletteValues(const u8& _data);
@@ -486,6 +497,16 @@ namespace Emulation {
 			sound_context sound_ctx = sound_context();
 			control_context control_ctx = control_context();
 			serial_context serial_ctx = serial_context();
+
+			mem_state savedState = mem_state();
+
+			// DMA transfers and LCDC writes step the components of the same machine
+			std::weak_ptr<GameboyCPU> m_CoreInstance;
+			std::weak_ptr<GameboyGPU> m_GraphicsInstance;
+			// JOYP reads latch the newest host input
+			std::weak_ptr<GameboyCTRL> m_ControlInstance;
+			// sound register and wave RAM writes change the channel outputs at the tick they happen
+			std::weak_ptr<GameboyAPU> m_SoundInstance;
 		};
 	}
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "GameboyMMU.h"
+#include "Machine.h"
 
 #include "GameboyMEM.h"
 #include "gameboy_defines.h"
@@ -73,7 +74,7 @@ namespace Emulation {
 			{0xFF, HuC1_RAM_BATTERY}
 		};
 
-		std::shared_ptr<GameboyMMU> GameboyMMU::s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge) {
+		std::shared_ptr<GameboyMMU> GameboyMMU::s_Create(std::shared_ptr<BaseCartridge> _cartridge) {
 			const auto vec_rom = _cartridge->GetRom();
 			u8 type_code = vec_rom[ROM_HEAD_HW_TYPE];
 
@@ -128,8 +129,8 @@ namespace Emulation {
 
 		GameboyMMU::GameboyMMU(std::shared_ptr<BaseCartridge> _cartridge) : BaseMMU() {}
 
-		void GameboyMMU::Init() {
-			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(BaseMEM::s_GetInstance());
+		void GameboyMMU::Init(const Machine& _machine) {
+			m_MemInstance = std::dynamic_pointer_cast<GameboyMEM>(_machine.GetMem());
 			machineCtx = m_MemInstance.lock()->GetMachineContext();
 		}
 
@@ -144,10 +145,15 @@ namespace Emulation {
 		*********************************************************************************************************** */
 		MmuSM83_ROM::MmuSM83_ROM(std::shared_ptr<BaseCartridge> _cartridge) : GameboyMMU(_cartridge) {}
 
-		void MmuSM83_ROM::Init() {
-			GameboyMMU::Init();
+		void MmuSM83_ROM::Init(const Machine& _machine) {
+			GameboyMMU::Init(_machine);
 		}
 
+		// no mapper registers
+		void MmuSM83_ROM::SaveState() {}
+
+		void MmuSM83_ROM::RestoreState() {}
+
 		/* ***********************************************************************************************************
 			MEMORY ACCESS
 		*********************************************************************************************************** */
@@ -299,8 +305,8 @@ namespace Emulation {
 *********************************************************************************************************** */
 		MmuSM83_MBC1::MmuSM83_MBC1(std::shared_ptr<BaseCartridge> _cartridge) : GameboyMMU(_cartridge) {}
 
-		void MmuSM83_MBC1::Init() {
-			GameboyMMU::Init();
+		void MmuSM83_MBC1::Init(const Machine& _machine) {
+			GameboyMMU::Init(_machine);
 
 			switch (machineCtx->ram_bank_num) {
 			case 0:
@@ -316,6 +322,19 @@ namespace Emulation {
 			}
 		}
 
+		// the selected banks are part of the machine context
+		void MmuSM83_MBC1::SaveState() {
+			savedState.ram_enable = ramEnable;
+			savedState.advanced_banking_mode = advancedBankingMode;
+			savedState.advanced_banking_value = advancedBankingValue;
+		}
+
+		void MmuSM83_MBC1::RestoreState() {
+			ramEnable = savedState.ram_enable;
+			advancedBankingMode = savedState.advanced_banking_mode;
+			advancedBankingValue = savedState.advanced_banking_value;
+		}
+
 		/* ***********************************************************************************************************
 			MEMORY ACCESS
 		*********************************************************************************************************** */
@@ -496,8 +515,20 @@ namespace Emulation {
 *********************************************************************************************************** */
 		MmuSM83_MBC3::MmuSM83_MBC3(std::shared_ptr<BaseCartridge> _cartridge) : GameboyMMU(_cartridge) {}
 
-		void MmuSM83_MBC3::Init() {
-			GameboyMMU::Init();
+		void MmuSM83_MBC3::Init(const Machine& _machine) {
+			GameboyMMU::Init(_machine);
+		}
+
+		void MmuSM83_MBC3::SaveState() {
+			savedState.timer_ram_enable = timerRamEnable;
+			savedState.timer_ram_was_enabled = timerRamWasEnabled;
+			savedState.rtc_registers_last_write = rtcRegistersLastWrite;
+		}
+
+		void MmuSM83_MBC3::RestoreState() {
+			timerRamEnable = savedState.timer_ram_enable;
+			timerRamWasEnabled = savedState.timer_ram_was_enabled;
+			rtcRegistersLastWrite = savedState.rtc_registers_last_write;
 		}
 
 		/* ***********************************************************************************************************
@@ -508,14 +539,12 @@ namespace Emulation {
 			if (_addr < ROM_N_OFFSET) {
 				// RAM/TIMER enable
 				if (_addr < MBC3_ROM_BANK_NUMBER_SELECT) {
-					static bool was_enabled = false;
-
 					timerRamEnable = (_data & MBC3_RAM_ENABLE_MASK) == MBC3_RAM_ENABLE_BITS;
-					if (was_enabled && !timerRamEnable && machineCtx->ram_present && machineCtx->battery_buffered) {
+					if (timerRamWasEnabled && !timerRamEnable && machineCtx->ram_present && machineCtx->battery_buffered) {
 						//WriteSave();
-						was_enabled = false;
+						timerRamWasEnabled = false;
 					} else {
-						was_enabled = true;
+						timerRamWasEnabled = true;
 					}
 				}
 				// ROM Bank number
@@ -705,8 +734,8 @@ namespace Emulation {
 *********************************************************************************************************** */
 		MmuSM83_MBC5::MmuSM83_MBC5(std::shared_ptr<BaseCartridge> _cartridge) : GameboyMMU(_cartridge) {}
 
-		void MmuSM83_MBC5::Init() {
-			GameboyMMU::Init();
+		void MmuSM83_MBC5::Init(const Machine& _machine) {
+			GameboyMMU::Init(_machine);
 
 			switch (machineCtx->ram_bank_num) {
 			case 0:
@@ -725,6 +754,18 @@ namespace Emulation {
 			}
 		}
 
+		void MmuSM83_MBC5::SaveState() {
+			savedState.ram_enable = ramEnable;
+			savedState.rom_bank_value = romBankValue;
+			savedState.rom0_mapped = rom0Mapped;
+		}
+
+		void MmuSM83_MBC5::RestoreState() {
+			ramEnable = savedState.ram_enable;
+			romBankValue = savedState.rom_bank_value;
+			rom0Mapped = savedState.rom0_mapped;
+		}
+
 		/* ***********************************************************************************************************
 			MEMORY ACCESS
 		*********************************************************************************************************** */
@@ -21,8 +21,8 @@ namespace Emulation {
 		public:
 			friend class BaseMMU;
 
-			static std::shared_ptr<GameboyMMU> s_GetInstance(std::shared_ptr<BaseCartridge> _cartridge);
-			virtual void Init() override;
+			static std::shared_ptr<GameboyMMU> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+			virtual void Init(const Machine& _machine) override;
 
 			// members
 			virtual void Write8Bit(const u8& _data, const u16& _addr) override = 0;
@@ -87,7 +87,9 @@ namespace Emulation {
 			friend class GameboyMMU;
 			// constructor
 			explicit MmuSM83_ROM(std::shared_ptr<BaseCartridge> _cartridge);
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			// members
 			void Write8Bit(const u8& _data, const u16& _addr) override;
@@ -101,12 +103,20 @@ namespace Emulation {
 		*		MBC1
 		*
 		*********************************************************************************************************** */
+		struct mbc1_state {
+			bool ram_enable = false;
+			bool advanced_banking_mode = false;
+			u8 advanced_banking_value = 0x00;
+		};
+
 		class MmuSM83_MBC1 : public GameboyMMU {
 		public:
 			friend class GameboyMMU;
 			// constructor
 			explicit MmuSM83_MBC1(std::shared_ptr<BaseCartridge> _cartridge);
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			// members
 			void Write8Bit(const u8& _data, const u16& _addr) override;
@@ -121,6 +131,8 @@ namespace Emulation {
 
 			bool advancedBankingMode = false;
 			u8 advancedBankingValue = 0x00;
+
+			mbc1_state savedState = mbc1_state();
 		};
 
 		/* ***********************************************************************************************************
@@ -128,12 +140,21 @@ namespace Emulation {
 		*		MBC3
 		*
 		*********************************************************************************************************** */
+		// the RTC follows the host clock and isn't part of the state
+		struct mbc3_state {
+			bool timer_ram_enable = false;
+			bool timer_ram_was_enabled = false;
+			u8 rtc_registers_last_write = 0x00;
+		};
+
 		class MmuSM83_MBC3 : public GameboyMMU {
 		public:
 			friend class GameboyMMU;
 			// constructor
 			explicit MmuSM83_MBC3(std::shared_ptr<BaseCartridge> _cartridge);
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			// members
 			void Write8Bit(const u8& _data, const u16& _addr) override;
@@ -144,8 +165,11 @@ namespace Emulation {
 		private:
 			// mbc3 control
 			bool timerRamEnable = false;
+			bool timerRamWasEnabled = false;
 			u8 rtcRegistersLastWrite = 0x00;
 
+			mbc3_state savedState = mbc3_state();
+
 			void LatchClock();
 			u8 ReadClock();
 			void WriteClock(const u8& _data);
@@ -156,12 +180,20 @@ namespace Emulation {
 		*		MBC5
 		*
 		*********************************************************************************************************** */
+		struct mbc5_state {
+			bool ram_enable = false;
+			int rom_bank_value = 0x00;
+			bool rom0_mapped = false;
+		};
+
 		class MmuSM83_MBC5 : public GameboyMMU {
 		public:
 			friend class GameboyMMU;
 			// constructor
 			explicit MmuSM83_MBC5(std::shared_ptr<BaseCartridge> _cartridge);
-			void Init() override;
+			void Init(const Machine& _machine) override;
+			void SaveState() override;
+			void RestoreState() override;
 
 			// members
 			void Write8Bit(const u8& _data, const u16& _addr) override;
@@ -176,6 +208,8 @@ namespace Emulation {
 
 			int romBankValue = 0x00;
 			bool rom0Mapped = false;
+
+			mbc5_state savedState = mbc5_state();
 		};
 	}
 }
\ No newline at end of file
@@ -60,7 +60,7 @@ namespace GUI {
         distLowPassEnable = aud_settings.dist_low_pass_enable;
         baseVolume = aud_settings.base_volume;
 
-        m_Vhwmgr = Emulation::VHardwareMgr::s_GetInstance();
+        m_Vhwmgr = Emulation::VHardwareMgr::s_Create();
 
         // init explorer
         NFD_Init();
@@ -73,7 +73,7 @@ namespace GUI {
         }
 
         // set emulation speed to 1x
-        ActionSetEmulationSpeed(0);
+        ActionSetEmulationSpeed(Config::EMULATION_SPEED_DEFAULT_INDEX);
 
         // read games from config
         ReloadGamesGuiCtx();
@@ -98,7 +98,7 @@ namespace GUI {
         if (gameRunning) {
             m_Vhwmgr->ShutdownHardware();
         }
-        Emulation::VHardwareMgr::s_ResetInstance();
+        m_Vhwmgr.reset();
     }
 
     /* ***********************************************************************************************************
@@ -113,6 +113,14 @@ namespace GUI {
             m_Vhwmgr->SetDebugEnabled(debug_enabled);
         }
 
+        // the profiler only runs while the overlay or the hardware info (PPU throughput) shows its data
+        static bool profiler_enabled = showGraphicsOverlay || showHardwareInfo;
+        if (profiler_enabled != (showGraphicsOverlay || showHardwareInfo)) {
+            profiler_enabled = showGraphicsOverlay || showHardwareInfo;
+
+            m_Vhwmgr->SetProfilerEnabled(profiler_enabled);
+        }
+
         // keys
         auto& inputs = Backend::HardwareMgr::GetKeyQueue();
         while (!inputs.empty()) {
@@ -170,11 +178,21 @@ namespace GUI {
 
     void GuiMgr::ProcessGUI() {
         //IM_ASSERT(ImGui::GetCurrentContext() != nullptr && "Missing dear imgui context. Refer to examples app!");
+        if (gameRunning && !m_Vhwmgr->IsRunning()) {
+            ActionGameStop();
+        }
+
         if (gameRunning) {
             if (showGraphicsOverlay || showHardwareInfo) { m_Vhwmgr->GetFpsAndClock(virtualFramerate, virtualFrequency); }
+            if (showGraphicsOverlay) {
+                m_Vhwmgr->GetFramePacing(framePacing);
+                m_Vhwmgr->GetFrameProfile(profileFrames);
+                achievedSpeed = m_Vhwmgr->GetAchievedSpeed();
+            }
             if (showHardwareInfo) { m_Vhwmgr->GetHardwareInfo(hardwareInfo); }
             if (showInstrDebugger) {
                 m_Vhwmgr->GetInstrDebugFlags(regValues, flagValues, miscValues);
+                if (m_Vhwmgr->GetDebugData(debugData)) { ProcessDebugData(debugData); }
             }
         }
 
@@ -341,7 +359,7 @@ namespace GUI {
         ImGui::Checkbox("Auto run", &autoRun);
         if (auto_run != autoRun) {
             auto_run = autoRun;
-            autoRunInstructions.store(auto_run);
+            m_Vhwmgr->SetAutoRun(auto_run);
         }
     }
 
@@ -742,12 +760,31 @@ namespace GUI {
             ImGui::TextUnformatted(to_string(virtualFramerate).c_str());
             ImGui::SameLine();
             ImGui::TextUnformatted("FPS (Emu)");
+            if (gameRunning) {
+                ImGui::SameLine();
+                ImGui::Text("(x%.2f)", achievedSpeed);
+            }
 
             ImGui::TextUnformatted(to_string(graphicsFPScur).c_str());
             ImGui::SameLine();
             ImGui::TextUnformatted("FPS (App)");
             ImGui::PlotLines("", graphicsFPSsamples, IM_ARRAYSIZE(graphicsFPSsamples), 0, nullptr, .0f, graphicsFPSmax, ImVec2(0, 80.0f));
 
+            if (gameRunning && !framePacing.start_error.empty()) {
+                ImGui::Separator();
+                ImGui::Text("Frame start error (%ius bins)", framePacing.start_error_bin_us);
+                ImGui::Text("avg %.1fus, max %.0fus", framePacing.start_error_avg_us, framePacing.start_error_max_us);
+                ImGui::PlotHistogram("##start_error", framePacing.start_error.data(), (int)framePacing.start_error.size(), 0, nullptr, .0f, FLT_MAX, ImVec2(0, 60.0f));
+
+                ImGui::Text("Emulation time per frame (%ius bins)", framePacing.emulation_time_bin_us);
+                ImGui::PlotHistogram("##emulation_time", framePacing.emulation_time.data(), (int)framePacing.emulation_time.size(), 0, nullptr, .0f, FLT_MAX, ImVec2(0, 60.0f));
+            }
+
+            if (gameRunning && !profileFrames.empty()) {
+                ImGui::Separator();
+                ShowFrameProfile();
+            }
+
             if (ImGui::BeginPopupContextWindow()) {
                 if (ImGui::MenuItem("Top-left", nullptr, graphicsOverlayCorner == 0)) graphicsOverlayCorner = 0;
                 if (ImGui::MenuItem("Top-right", nullptr, graphicsOverlayCorner == 1)) graphicsOverlayCorner = 1;
@@ -761,6 +798,46 @@ namespace GUI {
         }
     }
 
+    // stacked column per frame (newest on the right), scaled to the slowest frame shown
+    void GuiMgr::ShowFrameProfile() {
+        Emulation::profiler_frame average = {};
+        float max_total = .0f;
+        for (const auto& n : profileFrames) {
+            float total = .0f;
+            for (int i = 0; i < Emulation::PROFILE_SECTIONS_NUM; i++) {
+                total += std::max(n[i], .0f);
+                average[i] += n[i] / profileFrames.size();
+            }
+            max_total = std::max(max_total, total);
+        }
+
+        ImGui::Text("Frame time per subsystem (max %.0fus)", max_total);
+
+        ImVec2 size = ImVec2(ImGui::CalcItemWidth(), 80.f);
+        ImVec2 pos = ImGui::GetCursorScreenPos();
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        draw_list->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+        if (max_total > .0f) {
+            float column_width = size.x / (PROFILER_FRAMES - 1);
+            for (size_t i = 0; i < profileFrames.size(); i++) {
+                float x = pos.x + size.x - (profileFrames.size() - i) * column_width;
+                float y = pos.y + size.y;
+
+                for (int j = 0; j < Emulation::PROFILE_SECTIONS_NUM; j++) {
+                    float height = std::max(profileFrames[i][j], .0f) / max_total * size.y;
+                    draw_list->AddRectFilled(ImVec2(x, y - height), ImVec2(x + column_width, y), ImColor::HSV(j / (float)Emulation::PROFILE_SECTIONS_NUM, .6f, .9f));
+                    y -= height;
+                }
+            }
+        }
+        ImGui::Dummy(size);
+
+        for (int i = 0; i < Emulation::PROFILE_SECTIONS_NUM; i++) {
+            ImGui::TextColored(ImColor::HSV(i / (float)Emulation::PROFILE_SECTIONS_NUM, .6f, .9f), "%s: avg %.0fus", Emulation::PROFILE_SECTION_NAMES[i], average[i]);
+        }
+    }
+
     void GuiMgr::ShowGraphicsSettings() {
         static bool was_unlimited = fpsUnlimited;
         static bool was_triple_buffering = tripleBuffering;
@@ -1310,6 +1387,73 @@ namespace GUI {
 
                 
 
+                ImGui::PopStyleVar();
+                ImGui::EndTable();
+            }
+
+            ImGui::TextColored(HIGHLIGHT_COLOR, "Rendering");
+
+            if (ImGui::BeginTable("emulation rendering settings", 2, Config::TABLE_FLAGS_NO_BORDER_OUTER_H)) {
+
+                for (int i = 0; i < 2; i++) {
+                    ImGui::TableSetupColumn("", Config::TABLE_COLUMN_FLAGS_NO_HEADER);
+                }
+
+                ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, { 3, 3 });
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted("Render thread (next start)");
+                ImGui::TableNextColumn();
+                ImGui::Checkbox("##render_thread", &renderThread);
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted("CGB color correction (next start)");
+                ImGui::TableNextColumn();
+                ImGui::Checkbox("##color_correction", &colorCorrection);
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted("Sync to audio clock (next start)");
+                ImGui::TableNextColumn();
+                ImGui::Checkbox("##audio_sync", &audioSync);
+
+                // 0 runs the game normally, otherwise the audio gets rendered to a file without frame pacing
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted("Render audio seconds (next start)");
+                ImGui::TableNextColumn();
+                if (ImGui::InputInt("##audio_render", &audioRenderSeconds)) {
+                    if (audioRenderSeconds < 0) { audioRenderSeconds = 0; }
+                }
+
+                // every frame ahead costs one more emulated frame per presented frame
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted("Run-ahead frames (next start)");
+                ImGui::TableNextColumn();
+                ImGui::SliderInt("##run_ahead", &runAheadFrames, 0, Config::RUN_AHEAD_FRAMES_MAX);
+
+                // busy waiting before each frame deadline, only needed when the OS timer wakes up late
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted("Frame pacer spin us (next start)");
+                ImGui::TableNextColumn();
+                ImGui::SliderInt("##frame_pacer_spin", &framePacerSpin, 0, Config::FRAME_PACER_SPIN_US_MAX);
+
+                // stored per game, the engine gets selected on game start
+                if (games.size() > 0) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted("Pixel FIFO PPU (selected game)");
+                    ImGui::TableNextColumn();
+                    if (ImGui::Checkbox("##accurate_graphics", &games[gameSelectedIndex]->accurateGraphics)) {
+                        if (!IO::write_games_to_config(games, true)) {
+                            LOG_ERROR("[emu] writing games to config");
+                        }
+                    }
+                }
+
                 ImGui::PopStyleVar();
                 ImGui::EndTable();
             }
@@ -1347,9 +1491,9 @@ namespace GUI {
 
     void GuiMgr::ActionStepThroughExecution() {
         if (gameRunning) {
-            nextInstruction.store(true);
             autoRun = false;
-            autoRunInstructions.store(false);
+            m_Vhwmgr->SetAutoRun(false);
+            m_Vhwmgr->SetProceedExecution(true);
         }
     }
 
@@ -1358,14 +1502,14 @@ namespace GUI {
             unique_lock<mutex> lock_debug_breakpoints(mutDebugBreakpoints);
             auto& current_table_breakpoints = pcSetToRam.load() ? breakpointsTableTmp : breakpointsTable;
 
+            // auto run always executes the first instruction and leaves the breakpoint on its own
             if (std::find(current_table_breakpoints.begin(), current_table_breakpoints.end(), currentIndex) != current_table_breakpoints.end()) {
                 autoRun = true;
-                nextInstruction.store(true);
             } else {
                 autoRun = !autoRun;
             }
 
-            autoRunInstructions.store(autoRun);
+            m_Vhwmgr->SetAutoRun(autoRun);
         }
     }
 
@@ -1526,6 +1670,20 @@ namespace GUI {
             
             _table_breakpoints.emplace_back(_current_index);
         }
+
+        PublishBreakpoints();
+    }
+
+    // the emulation thread checks the breakpoints on its own copy
+    void GuiMgr::PublishBreakpoints() {
+        Emulation::debug_breakpoints breakpoints = {};
+        for (const auto& n : breakpointsTable) {
+            breakpoints.rom.emplace_back(n.bank, n.address);
+        }
+        for (const auto& n : breakpointsTableTmp) {
+            breakpoints.ram.emplace_back(n.bank, n.address);
+        }
+        m_Vhwmgr->SetBreakpoints(breakpoints);
     }
 
     void GuiMgr::ActionSetFramerateTarget() {
@@ -1564,6 +1722,13 @@ namespace GUI {
             Emulation::emulation_settings emu_settings = {};
             emu_settings.debug_enabled = showInstrDebugger;
             emu_settings.emulation_speed = currentSpeed;
+            emu_settings.render_thread = renderThread;
+            emu_settings.color_correction = colorCorrection;
+            emu_settings.audio_sync = audioSync;
+            emu_settings.audio_render_seconds = audioRenderSeconds;
+            emu_settings.run_ahead_frames = runAheadFrames;
+            emu_settings.frame_pacer_spin_us = framePacerSpin;
+            emu_settings.profiler_enabled = showGraphicsOverlay || showHardwareInfo;
 
             auto& game = games[gameSelectedIndex];
             game->SetBootRom(false, "", Emulation::console_ids::CONSOLE_NONE);
@@ -1574,7 +1739,6 @@ namespace GUI {
                 }
             }
 
-            emu_settings.callback = [this](Emulation::debug_data& _data) { this->DebugCallback(_data); };
             emu_settings.cartridge = games[gameSelectedIndex];
             emu_settings.reset = _restart;
 
@@ -1602,6 +1766,10 @@ namespace GUI {
 
                 m_Vhwmgr->GetGraphicsDebugSettings(debugGraphicsSettings);
 
+                unique_lock<mutex> lock_debug_breakpoints(mutDebugBreakpoints);
+                PublishBreakpoints();
+                lock_debug_breakpoints.unlock();
+
                 //m_Vhwmgr->GetMemoryTypes(memoryTypes);
 
                 gameRunning = m_Vhwmgr->StartHardware() == 0x00;
@@ -1681,6 +1849,8 @@ namespace GUI {
         miscValues = std::vector<Emulation::reg_entry>();
         debugMemoryTables = std::vector<GuiTable::Table<Emulation::memory_entry>>();
         virtualFramerate = 0;
+        achievedSpeed = .0f;
+        profileFrames.clear();
         hardwareInfo = std::vector<Emulation::data_entry>();
     }
 
@@ -1833,9 +2003,9 @@ namespace GUI {
     }
 
     /* ***********************************************************************************************************
-        CALLBACKS
+        DEBUG DATA
     *********************************************************************************************************** */
-    void GuiMgr::DebugCallback(Emulation::debug_data& _data) {
+    void GuiMgr::ProcessDebugData(const Emulation::debug_data& _data) {
         GuiTable::bank_index tmp = GuiTable::bank_index(_data.bank, _data.pc);
 
         // instruction debugger 
@@ -1861,17 +2031,10 @@ namespace GUI {
             debugInstrAutoscroll.store(true);
         }
         lock_debug_instr.unlock();
-    
-        if (autoRunInstructions.load()) {
-            unique_lock<mutex> lock_debug_breakpoints(mutDebugBreakpoints);
-            auto& breakpoint_list = (pcSetToRam.load() ? breakpointsTableTmp : breakpointsTable);
-            if (find(breakpoint_list.begin(), breakpoint_list.end(), tmp) == breakpoint_list.end()) {
-                m_Vhwmgr->SetProceedExecution(true);
-            }
-        }
-        if (nextInstruction.load()) {
-            m_Vhwmgr->SetProceedExecution(true);
-            nextInstruction.store(false);
+
+        // the emulation thread stopped the auto run on its own
+        if (_data.breakpoint_hit) {
+            autoRun = false;
         }
     }
 
@@ -1904,12 +2067,17 @@ namespace GUI {
             Backend::FileIO::check_and_create_path(Config::ROM_FOLDER);
         }
 
+        void check_and_create_audio_folder() {
+            Backend::FileIO::check_and_create_path(Config::AUDIO_FOLDER);
+        }
+
         const unordered_map<Emulation::info_types, std::string> INFO_TYPES_MAP = {
             { Emulation::TITLE, "title" },
             { Emulation::CONSOLE,"console" },
             { Emulation::FILE_NAME,"file_name" },
             { Emulation::FILE_PATH,"file_path" },
-            { Emulation::GAME_VER,"game_ver" }
+            { Emulation::GAME_VER,"game_ver" },
+            { Emulation::ACCURATE_GRAPHICS,"accurate_graphics" }
         };
 
         void games_from_string(vector<std::shared_ptr<Emulation::BaseCartridge>>& _games, const vector<string>& _config_games) {
@@ -1921,6 +2089,7 @@ namespace GUI {
             string file_path = "";
             string console = "";
             string version = "";
+            bool accurate_graphics = false;
             Emulation::console_ids id = Emulation::CONSOLE_NONE;
 
             bool entries_found = false;
@@ -1932,8 +2101,13 @@ namespace GUI {
                 // find start of entry
                 if (line.find("[") == 0 && line.find("]") == line.length() - 1) {
                     if (entries_found) {
-                        _games.emplace_back(Emulation::BaseCartridge::existing_game(title, file_name, file_path, id, version));
+                        auto cartridge = Emulation::BaseCartridge::existing_game(title, file_name, file_path, id, version);
+                        if (cartridge != nullptr) {
+                            cartridge->accurateGraphics = accurate_graphics;
+                            _games.emplace_back(cartridge);
+                        }
                         title = file_name = file_path = version = "";
+                        accurate_graphics = false;
                         id = Emulation::CONSOLE_NONE;
                     }
                     entries_found = true;
@@ -1964,6 +2138,8 @@ namespace GUI {
                         file_path = parameter.back();
                     } else if (parameter.front().compare(INFO_TYPES_MAP.at(Emulation::GAME_VER)) == 0) {
                         version = parameter.back();
+                    } else if (parameter.front().compare(INFO_TYPES_MAP.at(Emulation::ACCURATE_GRAPHICS)) == 0) {
+                        accurate_graphics = parameter.back().compare("1") == 0;
                     }
                 }
             }
@@ -1976,6 +2152,7 @@ namespace GUI {
 
             auto cartridge = Emulation::BaseCartridge::existing_game(title, file_name, file_path, id, version);
             if (cartridge != nullptr) {
+                cartridge->accurateGraphics = accurate_graphics;
                 _games.emplace_back(cartridge);
             }
 
@@ -1991,6 +2168,7 @@ namespace GUI {
                 _config_games.emplace_back(INFO_TYPES_MAP.at(Emulation::FILE_PATH) + "=" + n->filePath);
                 _config_games.emplace_back(INFO_TYPES_MAP.at(Emulation::CONSOLE) + "=" + Emulation::FILE_EXTS.at(n->console).second);
                 _config_games.emplace_back(INFO_TYPES_MAP.at(Emulation::GAME_VER) + "=" + n->version);
+                _config_games.emplace_back(INFO_TYPES_MAP.at(Emulation::ACCURATE_GRAPHICS) + "=" + (n->accurateGraphics ? "1" : "0"));
             }
         }
 
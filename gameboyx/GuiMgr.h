@@ -167,6 +167,7 @@ namespace GUI {
 		// graphics overlay (FPS)
 		bool showGraphicsMenu = false;
 		int virtualFramerate = 0;
+		float achievedSpeed = .0f;
 		int graphicsOverlayCorner = 1;
 		float graphicsFPSsamples[FPS_SAMPLES_NUM];
 		std::queue<float> graphicsFPSfifo = std::queue<float>();
@@ -174,11 +175,13 @@ namespace GUI {
 		float graphicsFPSavg = .0f;
 		int graphicsFPScount = 0;
 		float graphicsFPScur = .0f;
+		Emulation::frame_pacing_stats framePacing = Emulation::frame_pacing_stats();
+		std::vector<Emulation::profiler_frame> profileFrames = std::vector<Emulation::profiler_frame>();
 
 		// emulation settings
 		// emulation speed multiplier
 		int currentSpeedIndex = 0;
-		int currentSpeed = 1;
+		float currentSpeed = 1.f;
 		std::vector<Bool> emulationSpeedsEnabled = std::vector<Bool>(Config::EMULATION_SPEEDS.size(), { false });
 		std::unordered_map<Emulation::console_ids, std::pair<bool, Emulation::console_ids>> useBootRom = {
 			{ Emulation::console_ids::GBC, { false, Emulation::console_ids::GBC } },
@@ -192,6 +195,12 @@ namespace GUI {
 			{Emulation::console_ids::GB, Config::BOOT_DMG},
 			{Emulation::console_ids::GBC, Config::BOOT_CGB}
 		};
+		bool renderThread = false;
+		bool colorCorrection = false;
+		bool audioSync = false;
+		int audioRenderSeconds = 0;
+		int runAheadFrames = 0;
+		int framePacerSpin = Config::FRAME_PACER_SPIN_US;
 
 		// graphics settings
 		int framerateTarget = 0;
@@ -238,6 +247,7 @@ namespace GUI {
 		void ShowHardwareInfo();
 		void ShowGraphicsInfo();
 		void ShowGraphicsOverlay();
+		void ShowFrameProfile();
 		void ShowGraphicsSettings();
 		void ShowAudioSettings();
 		void ShowDebugGraphics();
@@ -295,9 +305,10 @@ namespace GUI {
 		ImFont* mainFont;
 
 
-		void DebugCallback(Emulation::debug_data& _data);
-		alignas(64) std::atomic<bool> nextInstruction = false;
-		alignas(64) std::atomic<bool> autoRunInstructions = false;
+		// newest snapshot of the emulation thread, polled once per frame
+		Emulation::debug_data debugData = {};
+		void ProcessDebugData(const Emulation::debug_data& _data);
+		void PublishBreakpoints();
 		std::mutex mutDebugInstr;
 		std::mutex mutDebugBreakpoints;
 	};
@@ -313,5 +324,6 @@ namespace GUI {
 		void check_and_create_shader_folders();
 		void check_and_create_save_folders();
 		void check_and_create_rom_folder();
+		void check_and_create_audio_folder();
 	}
 }
\ No newline at end of file
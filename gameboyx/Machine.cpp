@@ -0,0 +1,103 @@
+#include "Machine.h"
+
+#include "logger.h"
+
+namespace Emulation {
+	/* ***********************************************************************************************************
+		(DE)INIT
+	*********************************************************************************************************** */
+	std::shared_ptr<Machine> Machine::s_Create(std::shared_ptr<BaseCartridge> _cartridge) {
+		struct shared_enabler : public Machine {};       // workaround for private constructor
+		std::shared_ptr<Machine> ptr = std::make_shared<shared_enabler>();
+
+		// the order matters, the mapper sets the RAM/battery flags of the cartridge the memory gets allocated with
+		ptr->m_CoreInstance = BaseCPU::s_Create(_cartridge);
+		ptr->m_MmuInstance = BaseMMU::s_Create(_cartridge);
+		ptr->m_MemInstance = BaseMEM::s_Create(_cartridge);
+		ptr->m_GraphicsInstance = BaseGPU::s_Create(_cartridge);
+		ptr->m_SoundInstance = BaseAPU::s_Create(_cartridge);
+		ptr->m_ControlInstance = BaseCTRL::s_Create(_cartridge);
+		ptr->m_Profiler = std::make_shared<FrameProfiler>();
+
+		if (ptr->m_CoreInstance == nullptr ||
+			ptr->m_MmuInstance == nullptr ||
+			ptr->m_MemInstance == nullptr ||
+			ptr->m_GraphicsInstance == nullptr ||
+			ptr->m_SoundInstance == nullptr ||
+			ptr->m_ControlInstance == nullptr) {
+			LOG_ERROR("[emu] creating machine for ", _cartridge->title);
+			return nullptr;
+		}
+
+		return ptr;
+	}
+
+	// the components only hold weak references to each other, the order of destruction stays the same as before
+	Machine::~Machine() {
+		m_GraphicsInstance.reset();
+		m_SoundInstance.reset();
+		m_CoreInstance.reset();
+		m_ControlInstance.reset();
+		m_MmuInstance.reset();
+		m_MemInstance.reset();
+	}
+
+	void Machine::Init() {
+		m_CoreInstance->Init(*this);
+		m_MmuInstance->Init(*this);
+		m_MemInstance->Init(*this);
+		m_GraphicsInstance->Init(*this);
+		m_SoundInstance->Init(*this);
+		m_ControlInstance->Init(*this);
+	}
+
+	/* ***********************************************************************************************************
+		STATE
+	*********************************************************************************************************** */
+	void Machine::SaveState() {
+		m_CoreInstance->SaveState();
+		m_MmuInstance->SaveState();
+		m_MemInstance->SaveState();
+		m_GraphicsInstance->SaveState();
+		m_SoundInstance->SaveState();
+	}
+
+	void Machine::RestoreState() {
+		m_CoreInstance->RestoreState();
+		m_MmuInstance->RestoreState();
+		m_MemInstance->RestoreState();
+		m_GraphicsInstance->RestoreState();
+		m_SoundInstance->RestoreState();
+	}
+
+	/* ***********************************************************************************************************
+		COMPONENT ACCESS
+	*********************************************************************************************************** */
+	std::shared_ptr<BaseCPU> Machine::GetCore() const {
+		return m_CoreInstance;
+	}
+
+	std::shared_ptr<BaseMMU> Machine::GetMmu() const {
+		return m_MmuInstance;
+	}
+
+	std::shared_ptr<BaseMEM> Machine::GetMem() const {
+		return m_MemInstance;
+	}
+
+	std::shared_ptr<BaseGPU> Machine::GetGraphics() const {
+		return m_GraphicsInstance;
+	}
+
+	std::shared_ptr<BaseAPU> Machine::GetSound() const {
+		return m_SoundInstance;
+	}
+
+	std::shared_ptr<BaseCTRL> Machine::GetControl() const {
+		return m_ControlInstance;
+	}
+
+	std::shared_ptr<FrameProfiler> Machine::GetProfiler() const {
+		return m_Profiler;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	One emulated console. The machine owns exactly one instance of every hardware component and hands itself to
+*	their Init methods, where they pick up the components they interact with. No component reaches for a global,
+*	so several machines can run side by side on different threads (the graphics and audio backend are the only
+*	shared resources, headless machines use a non presentable pixel format and offline audio output).
+*/
+
+#include "BaseCPU.h"
+#include "BaseMMU.h"
+#include "BaseMEM.h"
+#include "BaseGPU.h"
+#include "BaseAPU.h"
+#include "BaseCTRL.h"
+#include "BaseCartridge.h"
+#include "FrameProfiler.h"
+
+namespace Emulation {
+	class Machine {
+	public:
+		// returns nullptr if one of the components isn't available for the cartridge (e.g. unsupported mapper)
+		static std::shared_ptr<Machine> s_Create(std::shared_ptr<BaseCartridge> _cartridge);
+		~Machine();
+
+		// settings which have to be applied before (e.g. pixel format) go directly to the components
+		void Init();
+
+		// run-ahead: every component copies its emulated state into a single in-memory slot and back. Only valid
+		// between two RunCycles calls. The slots get sized by the first save, afterwards saving and restoring
+		// don't allocate. Host side state (frame buffer, audio output, input queue) isn't part of it.
+		void SaveState();
+		void RestoreState();
+
+		// clone/assign protection
+		Machine(Machine const&) = delete;
+		Machine(Machine&&) = delete;
+		Machine& operator=(Machine const&) = delete;
+		Machine& operator=(Machine&&) = delete;
+
+		std::shared_ptr<BaseCPU> GetCore() const;
+		std::shared_ptr<BaseMMU> GetMmu() const;
+		std::shared_ptr<BaseMEM> GetMem() const;
+		std::shared_ptr<BaseGPU> GetGraphics() const;
+		std::shared_ptr<BaseAPU> GetSound() const;
+		std::shared_ptr<BaseCTRL> GetControl() const;
+		// shared by the components of this machine, the components keep a raw pointer (the machine outlives them)
+		std::shared_ptr<FrameProfiler> GetProfiler() const;
+
+	private:
+		Machine() = default;
+
+		std::shared_ptr<BaseCPU> m_CoreInstance;
+		std::shared_ptr<BaseMMU> m_MmuInstance;
+		std::shared_ptr<BaseMEM> m_MemInstance;
+		std::shared_ptr<BaseGPU> m_GraphicsInstance;
+		std::shared_ptr<BaseAPU> m_SoundInstance;
+		std::shared_ptr<BaseCTRL> m_ControlInstance;
+		std::shared_ptr<FrameProfiler> m_Profiler;
+	};
+}
\ No newline at end of file
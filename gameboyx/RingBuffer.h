@@ -0,0 +1,64 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Lock free ring buffer for exactly one producer and one consumer thread (e.g. emulation -> audio backend).
+*	The capacity gets rounded up to a power of 2, head and tail only ever increase and get masked on access.
+*	Neither side blocks: Push fails when there isn't enough space left, Pop returns what is available.
+*/
+
+#include <vector>
+#include <atomic>
+#include <bit>
+#include <algorithm>
+
+namespace Emulation {
+	template <class T> class RingBuffer {
+	public:
+		RingBuffer(const size_t& _size) : buffer(std::bit_ceil(_size)), mask(std::bit_ceil(_size) - 1) {}
+
+		// producer, either all or none of the elements get pushed
+		bool Push(const T* _data, const size_t& _num) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			size_t h = head.load(std::memory_order_acquire);
+			if (buffer.size() - (t - h) < _num) { return false; }
+
+			for (size_t i = 0; i < _num; i++) {
+				buffer[(t + i) & mask] = _data[i];
+			}
+
+			tail.store(t + _num, std::memory_order_release);
+			return true;
+		}
+
+		// consumer, returns the number of elements copied to _data
+		size_t Pop(T* _data, const size_t& _num) {
+			size_t h = head.load(std::memory_order_relaxed);
+			size_t t = tail.load(std::memory_order_acquire);
+			size_t num = std::min(_num, t - h);
+
+			for (size_t i = 0; i < num; i++) {
+				_data[i] = buffer[(h + i) & mask];
+			}
+
+			head.store(h + num, std::memory_order_release);
+			return num;
+		}
+
+		size_t Size() const {
+			return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+		}
+
+		size_t Capacity() const {
+			return buffer.size();
+		}
+
+	private:
+		std::vector<T> buffer;
+		size_t mask;
+
+		alignas(64) std::atomic<size_t> head = 0;		// written by the consumer
+		alignas(64) std::atomic<size_t> tail = 0;		// written by the producer
+	};
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Lock free triple buffer for exactly one writer and one reader thread (e.g. emulation -> GUI debugger).
+*	Writer and reader own one slot each, the third one gets swapped with them: the writer publishes its slot and
+*	continues with the previous one, the reader only swaps when something new got published.
+*	Neither side blocks or allocates after the slots got sized, the reader always gets the latest published state.
+*/
+
+#include <array>
+#include <atomic>
+
+namespace Emulation {
+	template <class T> class TripleBuffer {
+	public:
+		TripleBuffer() = default;
+
+		// writer, the slot stays valid until the next Publish
+		T& Write() {
+			return slots[writeSlot];
+		}
+
+		void Publish() {
+			writeSlot = middle.exchange(writeSlot | FRESH_BIT, std::memory_order_acq_rel) & SLOT_MASK;
+		}
+
+		// reader, false when nothing new got published since the last call
+		bool Read(T& _data) {
+			if ((middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) { return false; }
+
+			readSlot = middle.exchange(readSlot, std::memory_order_acq_rel) & SLOT_MASK;
+			_data = slots[readSlot];
+			return true;
+		}
+
+	private:
+		static constexpr int FRESH_BIT = 0x4;
+		static constexpr int SLOT_MASK = 0x3;
+
+		std::array<T, 3> slots;
+		int writeSlot = 0;
+		int readSlot = 1;
+
+		alignas(64) std::atomic<int> middle = 2;		// slot index | FRESH_BIT when not read yet
+	};
+}
\ No newline at end of file
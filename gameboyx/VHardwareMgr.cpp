@@ -1,6 +1,10 @@
 #include "VHardwareMgr.h"
 
 #include "logger.h"
+#include "helper_functions.h"
+
+#include <format>
+#include <algorithm>
 
 using namespace std;
 
@@ -8,24 +12,9 @@ namespace Emulation {
     /* ***********************************************************************************************************
         (DE)INIT
     *********************************************************************************************************** */
-    std::weak_ptr<VHardwareMgr> VHardwareMgr::m_Instance;
-
-    std::shared_ptr<VHardwareMgr> VHardwareMgr::s_GetInstance() {
-        std::shared_ptr<VHardwareMgr> ptr = m_Instance.lock();
-
-        if (!ptr) {
-            struct shared_enabler : public VHardwareMgr {};       // workaround for private constructor/destructor
-            ptr = std::make_shared<shared_enabler>();
-            m_Instance = ptr;
-        }
-
-        return ptr;
-    }
-
-    void VHardwareMgr::s_ResetInstance() {
-        if (m_Instance.lock()) {
-            m_Instance.reset();
-        }
+    std::shared_ptr<VHardwareMgr> VHardwareMgr::s_Create() {
+        struct shared_enabler : public VHardwareMgr {};       // workaround for private constructor/destructor
+        return std::make_shared<shared_enabler>();
     }
 
     VHardwareMgr::~VHardwareMgr() {
@@ -40,6 +29,8 @@ namespace Emulation {
         m_ControlInstance.reset();
         m_MmuInstance.reset();
         m_MemInstance.reset();
+        m_Profiler.reset();
+        m_Machine.reset();
     }
 
     /* ***********************************************************************************************************
@@ -58,36 +49,34 @@ namespace Emulation {
         } else {
             m_Cartridge = _emu_settings.cartridge;
             if (m_Cartridge->ReadRom()) {
-                m_CoreInstance = BaseCPU::s_GetInstance(m_Cartridge);
-                m_MmuInstance = BaseMMU::s_GetInstance(m_Cartridge);
-                m_MemInstance = BaseMEM::s_GetInstance(m_Cartridge);
-                m_GraphicsInstance = BaseGPU::s_GetInstance(m_Cartridge);
-                m_SoundInstance = BaseAPU::s_GetInstance(m_Cartridge);
-                m_ControlInstance = BaseCTRL::s_GetInstance(m_Cartridge);
-
-                if (m_CoreInstance != nullptr &&
-                    m_MemInstance != nullptr &&
-                    m_MmuInstance != nullptr &&
-                    m_GraphicsInstance != nullptr &&
-                    m_SoundInstance != nullptr &&
-                    m_ControlInstance != nullptr) {
-
-                    m_CoreInstance->Init();
-                    m_MmuInstance->Init();
-                    m_MemInstance->Init();
-                    m_GraphicsInstance->Init();
-                    m_SoundInstance->Init();
-                    m_ControlInstance->Init();
+                m_Machine = Machine::s_Create(m_Cartridge);
+
+                if (m_Machine != nullptr) {
+                    m_CoreInstance = m_Machine->GetCore();
+                    m_MmuInstance = m_Machine->GetMmu();
+                    m_MemInstance = m_Machine->GetMem();
+                    m_GraphicsInstance = m_Machine->GetGraphics();
+                    m_SoundInstance = m_Machine->GetSound();
+                    m_ControlInstance = m_Machine->GetControl();
+                    m_Profiler = m_Machine->GetProfiler();
+                    m_Profiler->SetEnabled(_emu_settings.profiler_enabled);
+
+                    m_GraphicsInstance->SetPixelFormat(_emu_settings.pixel_format);
+                    if (_emu_settings.audio_render_seconds > 0) {
+                        m_SoundInstance->SetOfflineOutput(Config::AUDIO_FOLDER + Helpers::sanitize_file_name(m_Cartridge->title) + Config::AUDIO_EXT);
+                    }
+                    m_Machine->Init();
+
+                    m_GraphicsInstance->SetRenderThreadEnable(_emu_settings.render_thread);
+                    m_GraphicsInstance->SetColorCorrection(_emu_settings.color_correction);
 
                     // returns the time per frame in ns
                     timePerFrame = std::chrono::microseconds(m_GraphicsInstance->GetDelayTime());
 
                     InitMembers(_emu_settings);
 
-                    dbgCallback = _emu_settings.callback;
-                    dbgData = {};
-                    m_CoreInstance->UpdateDebugData(&dbgData);
-                    dbgCallback(dbgData);
+                    debugPublished = false;
+                    PublishDebugData(false);
 
                     LOG_INFO("[emu] hardware for ", m_Cartridge->title, " initialized");
                     initialized = true;
@@ -108,7 +97,6 @@ namespace Emulation {
                 title = m_Cartridge->title;
             }
             LOG_ERROR("[emu] initializing hardware for ", title);
-            s_ResetInstance();
         }
 
         return errors;
@@ -136,7 +124,6 @@ namespace Emulation {
                 title = m_Cartridge->title;
             }
             LOG_ERROR("[emu] starting hardware for ", title);
-            s_ResetInstance();
         }
 
         return errors;
@@ -154,6 +141,9 @@ namespace Emulation {
         m_ControlInstance.reset();
         m_MmuInstance.reset();
         m_MemInstance.reset();
+        // the next machine brings its own profiler, nothing of this game shows up afterwards
+        m_Profiler.reset();
+        m_Machine.reset();
 
         string title;
         if (m_Cartridge == nullptr) {
@@ -165,43 +155,230 @@ namespace Emulation {
         LOG_INFO("[emu] hardware for ", title, " stopped");
     }
 
+    bool VHardwareMgr::IsRunning() const {
+        return running.load();
+    }
+
     void VHardwareMgr::ProcessHardware() {
         unique_lock<mutex> lock_hardware(mutHardware, defer_lock);
 
         while (running.load()) {
             if (debugEnable.load()) {
-                m_CoreInstance->UpdateDebugData(&dbgData);
-                dbgCallback(dbgData);
+                m_CoreInstance->SetCallstackEnable(true);
+                ProcessDebug(lock_hardware);
+            } else {
+                m_CoreInstance->SetCallstackEnable(false);
+                debugPublished = false;
+
+                float speed = emulationSpeed.load();
+                steady_clock::time_point time_busy = steady_clock::now();
+
+                int frames;
+                if (renderFrames > 0 || (audioSync && speed == 1.f)) {
+                    // paced by the audio device or not at all: exactly one frame per iteration
+                    RunFrame(true);
+                    frames = 1;
+                    creditTimePrev = steady_clock::now();
+                } else if (speed == Config::EMULATION_SPEED_UNCAPPED) {
+                    frames = RunUncapped();
+                } else {
+                    frames = RunCatchUp(speed);
+                }
 
-                if (proceedExecution.load()) {
-                    lock_hardware.lock();
-                    m_CoreInstance->RunCycle();
-                    lock_hardware.unlock();
+                u32 busy_time = (u32)duration_cast<microseconds>(steady_clock::now() - time_busy).count();
+                accumulatedBusyTime += busy_time;
+                if (frames > 0) {
+                    RecordHistogram(emulationTimeHistogram, busy_time / frames, Config::FRAME_PACER_EMULATION_BIN_US);
+                }
 
-                    proceedExecution.store(false);
+                if (renderFrames > 0) {
+                    renderFrames--;
+                    if (renderFrames == 0) {
+                        // the file is complete, the GUI stops the game once it sees the hardware finished
+                        m_SoundInstance->FinishOfflineOutput();
+                        LOG_INFO("[emu] audio rendering for ", m_Cartridge->title, " finished");
+                        running.store(false);
+                    }
+                } else if (audioSync && speed == 1.f) {
+                    DelayAudio();
+                } else {
+                    Delay();
                 }
-            } else {
-                for (int i = 0; i < emulationSpeed.load(); i++) {
-                    lock_hardware.lock();
-                    m_CoreInstance->RunCycles();
-                    lock_hardware.unlock();
+
+                // achieved speed over the whole iteration (pacing included), smoothed like the input latency
+                steady_clock::time_point now = steady_clock::now();
+                float elapsed = (float)duration_cast<microseconds>(now - time_busy).count();
+                if (elapsed > .0f) {
+                    float achieved = frames * (float)timePerFrame.count() / elapsed;
+                    currentSpeed.store(currentSpeed.load(std::memory_order_relaxed) * .9f + achieved * .1f, std::memory_order_relaxed);
+                }
+
+                // one entry per presented frame, the emulated frames of a catch-up share it
+                m_Profiler->EndFrame();
+                if (m_Profiler->IsEnabled() && m_Profiler->GetLastFrame(profileFrame)) {
+                    accumulatedPPUTime += profileFrame[PROFILE_PPU_MODES] + profileFrame[PROFILE_PPU_RENDER];
                 }
-                Delay();
             }
 
             CheckFpsAndClock();
         }
     }
 
+    // auto run executes instructions in bursts of up to a frame time and publishes a snapshot after each burst, step or breakpoint.
+    // The first instruction always gets executed, auto run continues from the breakpoint it stopped at.
+    void VHardwareMgr::ProcessDebug(unique_lock<mutex>& _lock_hardware) {
+        debugBreakpointUpdates.Read(debugBreakpoints);
+
+        bool step = proceedExecution.exchange(false);
+        if (!step && !autoRun.load()) {
+            if (!debugPublished) { PublishDebugData(false); }
+
+            std::unique_lock<mutex> lock_timedelta(mutTimeDelta);
+            notifyTimeDelta.wait_for(lock_timedelta, 1ms);
+            return;
+        }
+
+        steady_clock::time_point publish_time = steady_clock::now() + timePerFrame;
+        bool breakpoint_hit = false;
+
+        _lock_hardware.lock();
+        for (u32 i = 1; ; i++) {
+            m_CoreInstance->RunCycle();
+            breakpoint_hit = CheckBreakpoint();
+
+            if (step || breakpoint_hit) { break; }
+            // the clock and the GUI only get checked every few instructions
+            if ((i & 0xFF) == 0 && (!autoRun.load(std::memory_order_relaxed) || steady_clock::now() >= publish_time)) { break; }
+        }
+        _lock_hardware.unlock();
+
+        if (breakpoint_hit) {
+            autoRun.store(false);
+        }
+        PublishDebugData(breakpoint_hit);
+    }
+
+    bool VHardwareMgr::CheckBreakpoint() const {
+        int bank, pc;
+        m_CoreInstance->GetDebugIndex(bank, pc);
+
+        const auto& breakpoints = bank < 0 ? debugBreakpoints.ram : debugBreakpoints.rom;
+        if (breakpoints.empty()) { return false; }
+        return std::find(breakpoints.begin(), breakpoints.end(), std::pair<int, int>(std::max(bank, 0), pc)) != breakpoints.end();
+    }
+
+    void VHardwareMgr::PublishDebugData(const bool& _breakpoint_hit) {
+        debug_data& data = debugSnapshots.Write();
+        m_CoreInstance->UpdateDebugData(&data);
+        data.breakpoint_hit = _breakpoint_hit;
+        debugSnapshots.Publish();
+        debugPublished = true;
+    }
+
     void VHardwareMgr::InitMembers(emulation_settings& _settings) {
         timeSecondPrev = steady_clock::now();
         timeSecondCur = steady_clock::now();
-        timePointPrev = steady_clock::now();
-        timePointCur = steady_clock::now();
+        frameDeadline = steady_clock::now();
+        framePacerSpin = microseconds(std::clamp(_settings.frame_pacer_spin_us, 0, Config::FRAME_PACER_SPIN_US_MAX));
+        ResetFramePacing();
+        // half a frame of credit keeps the frames per iteration stable against the jitter of the wake up
+        frameCredit = .5;
+        creditTimePrev = steady_clock::now();
+        frameCostUs = .0f;
+        currentSpeed.store(.0f);
 
         running.store(true);
         debugEnable.store(_settings.debug_enabled);
+        proceedExecution.store(false);
+        autoRun.store(false);
         emulationSpeed.store(_settings.emulation_speed);
+        audioSync = _settings.audio_sync;
+        renderFrames = _settings.audio_render_seconds > 0 ? (int)(_settings.audio_render_seconds * 1000000 / timePerFrame.count()) : 0;
+        audioRender = renderFrames > 0;
+        m_SoundInstance->SetSynthesisBypass(!audioRender && emulationSpeed.load() != 1.f);
+
+        runAheadFrames = std::clamp(_settings.run_ahead_frames, 0, Config::RUN_AHEAD_FRAMES_MAX);
+        if (runAheadFrames > 0) {
+            // sizes the state slots, the following saves only copy
+            m_Machine->SaveState();
+            LOG_INFO("[emu] run-ahead: ", runAheadFrames, " frames");
+        }
+    }
+
+    // the real frame gets emulated with the current input and saved, the speculative ones run muted with the same input,
+    // only the last one gets rendered and presented. Restoring the state afterwards leaves the machine at the real frame.
+    // The frame presented may start in the previous speculative frame, that one renders as well.
+    void VHardwareMgr::RunAhead() {
+        m_GraphicsInstance->SetRenderBypass(runAheadFrames > 1);
+        m_CoreInstance->RunCycles();
+
+        m_Machine->SaveState();
+        m_ControlInstance->SetInputFrozen(true);
+        m_SoundInstance->SetSynthesisBypass(true);
+
+        for (int i = 1; i <= runAheadFrames; i++) {
+            m_GraphicsInstance->SetRenderBypass(i < runAheadFrames - 1);
+            m_CoreInstance->RunCycles();
+        }
+
+        m_Machine->RestoreState();
+        m_ControlInstance->SetInputFrozen(false);
+        m_SoundInstance->SetSynthesisBypass(!audioRender && emulationSpeed.load() != 1.f);
+    }
+
+    void VHardwareMgr::RunFrame(const bool& _render) {
+        unique_lock<mutex> lock_hardware(mutHardware);
+        if (runAheadFrames > 0 && renderFrames == 0 && emulationSpeed.load() == 1.f) {
+            RunAhead();
+        } else {
+            m_GraphicsInstance->SetRenderBypass(!_render);
+            m_CoreInstance->RunCycles();
+        }
+    }
+
+    // emulates the frames the wall clock owes since the last iteration, a fractional remainder carries over (e.g. x0.5 emulates
+    // every second iteration). The presented frame may start in the frame before, so the last two get rasterized.
+    int VHardwareMgr::RunCatchUp(const float& _speed) {
+        steady_clock::time_point now = steady_clock::now();
+        frameCredit += duration<double>(now - creditTimePrev) / timePerFrame * _speed;
+        creditTimePrev = now;
+
+        int frames = (int)frameCredit;
+        if (frames > Config::CATCH_UP_FRAMES_MAX) {
+            frames = Config::CATCH_UP_FRAMES_MAX;
+            frameCredit = .5;
+        } else {
+            frameCredit -= frames;
+        }
+
+        for (int i = 0; i < frames; i++) {
+            RunFrame(i >= frames - 2);
+        }
+        return frames;
+    }
+
+    // emulates frames without rasterizing them until the next deadline gets close, the last two before it get rasterized
+    int VHardwareMgr::RunUncapped() {
+        steady_clock::time_point present = frameDeadline + timePerFrame;
+
+        int frames = 0;
+        int rendered = 0;
+        while (rendered < 2 && running.load()) {
+            steady_clock::time_point start = steady_clock::now();
+            bool render = rendered > 0 || start + microseconds((int)(frameCostUs * 2)) >= present;
+            if (render) { rendered++; }
+
+            RunFrame(render);
+            frames++;
+
+            float cost = (float)duration_cast<microseconds>(steady_clock::now() - start).count();
+            frameCostUs = frameCostUs * .9f + cost * .1f;
+        }
+
+        // the speed can change back to a capped one, the credit starts over from here
+        frameCredit = .5;
+        creditTimePrev = steady_clock::now();
+        return frames;
     }
 
     // TODO: revise this section
@@ -216,8 +393,13 @@ namespace Emulation {
 
             currentFrequency.store((float)clockCount / accumulatedTime);
             currentFramerate.store((float)frameCount / (accumulatedTime / (float)pow(10, 6)));
+            // frames the whole machine and the PPU engine on its own could produce per second without frame pacing
+            currentThroughput.store(accumulatedBusyTime > 0 ? (float)frameCount / (accumulatedBusyTime / (float)pow(10, 6)) : 0.f);
+            currentPPUThroughput.store(accumulatedPPUTime > .0f ? (float)frameCount / (accumulatedPPUTime / (float)pow(10, 6)) : 0.f);
 
             accumulatedTime = 0;
+            accumulatedBusyTime = 0;
+            accumulatedPPUTime = .0f;
             m_CoreInstance->ResetClockCycles();
             m_GraphicsInstance->ResetFrameCount();
             return true;
@@ -225,14 +407,79 @@ namespace Emulation {
         return false;
     }
 
+    // hybrid pacing: the condition variable sleeps until shortly before the deadline, the remaining time gets yielded away
+    // to hit the deadline exactly
     void VHardwareMgr::Delay() {
-        timePointCur = steady_clock::now();
-        std::chrono::microseconds c_time_diff = duration_cast<microseconds>(timePointCur - timePointPrev);
+        ProfileScope profile_scope(m_Profiler.get(), PROFILE_PACING);
+        frameDeadline += timePerFrame;
+        steady_clock::time_point now = steady_clock::now();
+
+        // more than a frame behind (e.g. host too slow or stalled): start over instead of catching up with a burst of frames
+        if (now > frameDeadline + timePerFrame) {
+            frameDeadline = now;
+            return;
+        }
+
+        steady_clock::time_point wake_up = frameDeadline - framePacerSpin;
+        if (now < wake_up) {
+            std::unique_lock<mutex> lock_timedelta(mutTimeDelta);
+            notifyTimeDelta.wait_until(lock_timedelta, wake_up);
+        }
+
+        while ((now = steady_clock::now()) < frameDeadline) {
+            std::this_thread::yield();
+        }
+
+        u32 error = (u32)duration_cast<microseconds>(now - frameDeadline).count();
+        RecordHistogram(startErrorHistogram, error, Config::FRAME_PACER_ERROR_BIN_US);
+        startErrorSum.fetch_add(error, std::memory_order_relaxed);
+        if (error > startErrorMax.load(std::memory_order_relaxed)) {
+            startErrorMax.store(error, std::memory_order_relaxed);
+        }
+    }
+
+    void VHardwareMgr::RecordHistogram(std::vector<std::atomic<u32>>& _histogram, const int& _value_us, const int& _bin_us) {
+        int bin = std::min(_value_us / _bin_us, (int)_histogram.size() - 1);
+        _histogram[bin].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void VHardwareMgr::ResetFramePacing() {
+        for (auto& n : startErrorHistogram) {
+            n.store(0);
+        }
+        for (auto& n : emulationTimeHistogram) {
+            n.store(0);
+        }
+        startErrorSum.store(0);
+        startErrorMax.store(0);
+    }
+
+    // the audio device clock paces the emulation instead of only the system timer: a proportional controller stretches the
+    // generated samples by up to AUDIO_SYNC_MAX_ADJUST so the buffer settles at the target fill level, beyond that the emulation
+    // waits for the audio device (buffer too full) or skips the frame delay (buffer running empty)
+    void VHardwareMgr::DelayAudio() {
+        ProfileScope profile_scope(m_Profiler.get(), PROFILE_PACING);
+        float fill = m_SoundInstance->GetBufferFill();
+        float error = std::clamp((fill - Config::AUDIO_SYNC_TARGET_FILL) / Config::AUDIO_SYNC_TARGET_FILL, -1.f, 1.f);
+        m_SoundInstance->SetResamplingRatio(1.f + error * Config::AUDIO_SYNC_MAX_ADJUST);
+
+        if (fill < Config::AUDIO_SYNC_TARGET_FILL * .5f) {
+            frameDeadline = steady_clock::now();
+            return;
+        }
+
+        Delay();
+
+        // fall back to the frame time in case the audio device doesn't consume samples (e.g. paused)
+        steady_clock::time_point time_limit = steady_clock::now() + timePerFrame;
 
         std::unique_lock<mutex> lock_timedelta(mutTimeDelta);
-        notifyTimeDelta.wait_for(lock_timedelta, timePerFrame - c_time_diff);
+        while (running.load() && m_SoundInstance->GetBufferFill() > Config::AUDIO_SYNC_TARGET_FILL * 2.f && steady_clock::now() < time_limit) {
+            notifyTimeDelta.wait_for(lock_timedelta, 1ms);
+        }
 
-        timePointPrev = steady_clock::now();
+        // the audio device is the clock here, the next deadline starts from the end of the wait
+        frameDeadline = std::max(frameDeadline, steady_clock::now());
     }
 
     /* ***********************************************************************************************************
@@ -244,14 +491,55 @@ namespace Emulation {
         _fps = (int)currentFramerate.load();
     }
 
+    void VHardwareMgr::GetFramePacing(frame_pacing_stats& _stats) {
+        _stats.start_error.resize(startErrorHistogram.size());
+        _stats.emulation_time.resize(emulationTimeHistogram.size());
+
+        u32 frames = 0;
+        for (size_t i = 0; i < startErrorHistogram.size(); i++) {
+            u32 count = startErrorHistogram[i].load(std::memory_order_relaxed);
+            _stats.start_error[i] = (float)count;
+            frames += count;
+        }
+        for (size_t i = 0; i < emulationTimeHistogram.size(); i++) {
+            _stats.emulation_time[i] = (float)emulationTimeHistogram[i].load(std::memory_order_relaxed);
+        }
+
+        _stats.start_error_bin_us = Config::FRAME_PACER_ERROR_BIN_US;
+        _stats.emulation_time_bin_us = Config::FRAME_PACER_EMULATION_BIN_US;
+        _stats.start_error_avg_us = frames > 0 ? (float)startErrorSum.load(std::memory_order_relaxed) / frames : .0f;
+        _stats.start_error_max_us = (float)startErrorMax.load(std::memory_order_relaxed);
+    }
+
+    void VHardwareMgr::SetProfilerEnabled(const bool& _enabled) {
+        if (m_Profiler) {
+            m_Profiler->SetEnabled(_enabled);
+        }
+    }
+
+    void VHardwareMgr::GetFrameProfile(std::vector<profiler_frame>& _frames) const {
+        if (m_Profiler) {
+            m_Profiler->GetFrames(_frames);
+        } else {
+            _frames.clear();
+        }
+    }
+
+    float VHardwareMgr::GetAchievedSpeed() const {
+        return currentSpeed.load(std::memory_order_relaxed);
+    }
+
+    // lock free, the core applies the events at the next scanline or when the game reads the buttons
     void VHardwareMgr::EventButtonDown(const int& _player, const SDL_GameControllerButton& _key) {
-        unique_lock<mutex> lock_hardware(mutHardware);
-        m_ControlInstance->SetKey(_player, _key);
+        if (!m_ControlInstance->PushInput(_player, _key, true)) {
+            LOG_WARN("[emu] input queue full, button event dropped");
+        }
     }
 
     void VHardwareMgr::EventButtonUp(const int& _player, const SDL_GameControllerButton& _key) {
-        unique_lock<mutex> lock_hardware(mutHardware);
-        m_ControlInstance->ResetKey(_player, _key);
+        if (!m_ControlInstance->PushInput(_player, _key, false)) {
+            LOG_WARN("[emu] input queue full, button event dropped");
+        }
     }
 
     void VHardwareMgr::SetDebugEnabled(const bool& _debug_enabled) {
@@ -262,15 +550,34 @@ namespace Emulation {
         proceedExecution.store(_proceed_execution);
     }
 
-    void VHardwareMgr::SetEmulationSpeed(const int& _emulation_speed) {
+    void VHardwareMgr::SetAutoRun(const bool& _auto_run) {
+        autoRun.store(_auto_run);
+    }
+
+    void VHardwareMgr::SetBreakpoints(const debug_breakpoints& _breakpoints) {
+        debugBreakpointUpdates.Write() = _breakpoints;
+        debugBreakpointUpdates.Publish();
+    }
+
+    bool VHardwareMgr::GetDebugData(debug_data& _data) {
+        return debugSnapshots.Read(_data);
+    }
+
+    void VHardwareMgr::SetEmulationSpeed(const float& _emulation_speed) {
         emulationSpeed.store(_emulation_speed);
+        // the audio of any other speed never gets played back in time, offline rendering always needs it
+        if (m_SoundInstance) {
+            m_SoundInstance->SetSynthesisBypass(!audioRender && _emulation_speed != 1.f);
+        }
     }
 
     assembly_tables& VHardwareMgr::GetAssemblyTables() {
         return m_CoreInstance->GetAssemblyTables();
     }
 
+    // GUI thread, the code in RAM may change while the emulation runs
     void VHardwareMgr::GenerateTemporaryAssemblyTable(assembly_tables& _table) {
+        unique_lock<mutex> lock_hardware(mutHardware);
         m_CoreInstance->GenerateTemporaryAssemblyTable(_table);
     }
 
@@ -282,6 +589,14 @@ namespace Emulation {
     void VHardwareMgr::GetHardwareInfo(std::vector<data_entry>& _hardware_info) {
         //unique_lock<mutex> lock_hardware(mutHardware);
         m_CoreInstance->GetHardwareInfo(_hardware_info);
+        m_GraphicsInstance->GetHardwareInfo(_hardware_info);
+        m_SoundInstance->GetHardwareInfo(_hardware_info);
+        _hardware_info.emplace_back("Input latency", format("{:.0f}us", m_ControlInstance->GetInputLatency()));
+        _hardware_info.emplace_back("System throughput", format("{:.1f} frames/s", currentThroughput.load()));
+        // comparable between the PPU engines, N/A while the profiler is off
+        float ppu_throughput = currentPPUThroughput.load();
+        _hardware_info.emplace_back("PPU throughput", ppu_throughput > .0f ? format("{:.1f} frames/s", ppu_throughput) : N_A);
+        _hardware_info.emplace_back("Speed", format("x{:.2f}", currentSpeed.load()));
     }
 
     std::vector<memory_type_tables>& VHardwareMgr::GetMemoryTables() {
@@ -9,16 +9,13 @@
 
 #include "HardwareMgr.h"
 
-#include "BaseCPU.h"
-#include "BaseCTRL.h"
-#include "BaseAPU.h"
-#include "BaseGPU.h"
+#include "Machine.h"
 #include "BaseCartridge.h"
 #include "defs.h"
 #include "general_config.h"
 #include "VHardwareTypes.h"
+#include "TripleBuffer.h"
 
-#include <functional>
 #include <thread>
 #include <mutex>
 #include <queue>
@@ -29,10 +26,17 @@ using namespace std::chrono_literals;
 namespace Emulation {
     struct emulation_settings {
         bool debug_enabled = false;
-        int emulation_speed = 1;
+        float emulation_speed = 1.f;        // factor of the native speed, Config::EMULATION_SPEED_UNCAPPED: as fast as possible
+        bool render_thread = false;
+        bool color_correction = false;
+        pixel_formats pixel_format = PIXEL_FORMAT_RGBA8888;
+        bool audio_sync = false;
+        int audio_render_seconds = 0;       // > 0: renders the audio of the given emulated time to a file as fast as possible
+        bool profiler_enabled = false;
+        int run_ahead_frames = 0;           // > 0: presents the frame the given number of frames ahead of the input, hides the game's input lag
+        int frame_pacer_spin_us = Config::FRAME_PACER_SPIN_US;
         std::shared_ptr<BaseCartridge> cartridge;
         bool reset;
-        std::function<void(debug_data&)> callback;
     };
 
     enum Errors {
@@ -57,8 +61,8 @@ namespace Emulation {
 
     class VHardwareMgr {
     public:
-        static std::shared_ptr<VHardwareMgr> s_GetInstance();
-        static void s_ResetInstance();
+        // every manager runs its own machine on its own thread
+        static std::shared_ptr<VHardwareMgr> s_Create();
 
         u8 InitHardware(emulation_settings& _emu_settings);
         u8 StartHardware();
@@ -66,6 +70,8 @@ namespace Emulation {
 
         // members for running hardware
         void ProcessHardware();
+        // false once the hardware stopped on its own (e.g. offline audio rendering finished)
+        bool IsRunning() const;
 
         // SDL
         void EventButtonDown(const int& _player, const SDL_GameControllerButton& _key);
@@ -73,9 +79,17 @@ namespace Emulation {
 
         void SetDebugEnabled(const bool& _debug_enabled);
         void SetProceedExecution(const bool& _proceed_execution);
-        void SetEmulationSpeed(const int& _emulation_speed);
+        void SetAutoRun(const bool& _auto_run);
+        void SetBreakpoints(const debug_breakpoints& _breakpoints);
+        // GUI thread, false when nothing new got published since the last call
+        bool GetDebugData(debug_data& _data);
+        void SetEmulationSpeed(const float& _emulation_speed);
 
         void GetFpsAndClock(int& _fps, float& _clock);
+        void GetFramePacing(frame_pacing_stats& _stats);
+        void SetProfilerEnabled(const bool& _enabled);
+        void GetFrameProfile(std::vector<profiler_frame>& _frames) const;
+        float GetAchievedSpeed() const;
 
         assembly_tables& GetAssemblyTables();
         void GenerateTemporaryAssemblyTable(assembly_tables& _table);
@@ -91,37 +105,74 @@ namespace Emulation {
     private:
         VHardwareMgr() = default;
         ~VHardwareMgr();
-        static std::weak_ptr<VHardwareMgr> m_Instance;
 
-        // hardware instances
+        // hardware instances, owned by the machine
+        std::shared_ptr<Machine> m_Machine;
         std::shared_ptr<BaseCPU> m_CoreInstance;
         std::shared_ptr<BaseMMU> m_MmuInstance;
         std::shared_ptr<BaseMEM> m_MemInstance;
         std::shared_ptr<BaseAPU> m_SoundInstance;
         std::shared_ptr<BaseGPU> m_GraphicsInstance;
         std::shared_ptr<BaseCTRL>  m_ControlInstance;
+        std::shared_ptr<FrameProfiler> m_Profiler;
         std::shared_ptr<BaseCartridge> m_Cartridge;
 
         // execution time (e.g. 60FPS -> 1/60th of a second)
         std::chrono::microseconds timePerFrame;
         void Delay();
 
+        // absolute deadline of the next frame, the error of one frame doesn't carry over to the following ones
+        steady_clock::time_point frameDeadline;
+        microseconds framePacerSpin = microseconds(Config::FRAME_PACER_SPIN_US);
+        std::vector<std::atomic<u32>> startErrorHistogram = std::vector<std::atomic<u32>>(Config::FRAME_PACER_HISTOGRAM_BINS);
+        std::vector<std::atomic<u32>> emulationTimeHistogram = std::vector<std::atomic<u32>>(Config::FRAME_PACER_HISTOGRAM_BINS);
+        alignas(64) std::atomic<u64> startErrorSum = 0;
+        alignas(64) std::atomic<u32> startErrorMax = 0;
+        void RecordHistogram(std::vector<std::atomic<u32>>& _histogram, const int& _value_us, const int& _bin_us);
+        void ResetFramePacing();
+
+        // audio clock pacing, holds the emulation at the target fill level of the audio buffer
+        bool audioSync = false;
+        void DelayAudio();
+
+        // offline audio rendering, frames left to emulate without frame pacing
+        bool audioRender = false;
+        int renderFrames = 0;
+
+        // run-ahead, emulates the frames ahead from a saved state and rolls back after presenting the last one
+        int runAheadFrames = 0;
+        void RunAhead();
+
+        // speed control: every iteration presents at most one frame and emulates the frames the wall clock owes at the selected
+        // speed, only the presented one gets rasterized
+        double frameCredit = .0;
+        steady_clock::time_point creditTimePrev;
+        float frameCostUs = .0f;
+        void RunFrame(const bool& _render);
+        int RunCatchUp(const float& _speed);
+        int RunUncapped();
+
         int frameCount = 0;
         int clockCount = 0;
 
         // timestamps for core virtualFrequency and virtualFramerate calculation
         steady_clock::time_point timeSecondPrev;
         steady_clock::time_point timeSecondCur;
-        steady_clock::time_point timePointPrev;
-        steady_clock::time_point timePointCur;
         u32 accumulatedTime = 0;
         u32 accumulatedTimeTmp = 0;
+        u32 accumulatedBusyTime = 0;
+        // time of the PPU alone (modes and rasterization, see FrameProfiler), only measured while the profiler runs
+        float accumulatedPPUTime = .0f;
+        profiler_frame profileFrame = {};
 
         Errors errors;
         bool initialized = false;
 
         alignas(64) std::atomic<float> currentFrequency = 0;
         alignas(64) std::atomic<float> currentFramerate = 0;
+        alignas(64) std::atomic<float> currentThroughput = 0;
+        alignas(64) std::atomic<float> currentPPUThroughput = 0;
+        alignas(64) std::atomic<float> currentSpeed = 0;
 
         std::thread hardwareThread;
         std::mutex mutHardware;
@@ -133,12 +184,18 @@ namespace Emulation {
         alignas(64) std::atomic<bool> debugEnable;
         alignas(64) std::atomic<bool> proceedExecution;
         alignas(64) std::atomic<bool> autoRun;
-        alignas(64) std::atomic<int> emulationSpeed;
+        alignas(64) std::atomic<float> emulationSpeed;
 
         bool CheckFpsAndClock();
         void InitMembers(emulation_settings& _settings);
 
-        std::function<void(debug_data&)> dbgCallback;
-        debug_data dbgData;
+        // debugger: the emulation thread runs and checks the breakpoints on its own, the GUI only polls the snapshots
+        TripleBuffer<debug_data> debugSnapshots;
+        TripleBuffer<debug_breakpoints> debugBreakpointUpdates;
+        debug_breakpoints debugBreakpoints;
+        bool debugPublished = false;
+        void ProcessDebug(std::unique_lock<std::mutex>& _lock_hardware);
+        bool CheckBreakpoint() const;
+        void PublishDebugData(const bool& _breakpoint_hit);
     };
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "general_config.h"
 #include <vector>
+#include <array>
 #include <string>
 
 namespace Emulation {
@@ -18,11 +19,31 @@ namespace Emulation {
         int dest_addr;
     };
 
+    // published by the emulation thread after a step, a breakpoint or at most once per frame while running
     struct debug_data {
         int pc = 0;
         int bank = 0;
+        bool breakpoint_hit = false;
 
-        std::vector<callstack_data> callstack;
+        // oldest to newest, the core only keeps the newest DEBUG_CALLSTACK_DEPTH entries
+        std::array<callstack_data, DEBUG_CALLSTACK_DEPTH> callstack = {};
+        int callstack_size = 0;
+    };
+
+    // (bank, address), code in RAM has no bank and uses 0
+    struct debug_breakpoints {
+        std::vector<std::pair<int, int>> rom;
+        std::vector<std::pair<int, int>> ram;
+    };
+
+    // histograms of the frame pacing (counts per bin), the last bin collects everything beyond
+    struct frame_pacing_stats {
+        std::vector<float> start_error;             // actual frame start - deadline
+        std::vector<float> emulation_time;          // busy time of the emulation per frame
+        int start_error_bin_us = 0;
+        int emulation_time_bin_us = 0;
+        float start_error_avg_us = .0f;
+        float start_error_max_us = .0f;
     };
 
     enum {
@@ -50,6 +71,27 @@ namespace Emulation {
     };
     using memory_entry = std::tuple<std::string, int, u8*>;
 
+    // layout of the emulated frame buffer, colors get converted once when palettes are written
+    enum pixel_formats {
+        PIXEL_FORMAT_RGBA8888,      // bytes R, G, B, A (graphics backend)
+        PIXEL_FORMAT_BGRA8888,      // bytes B, G, R, A
+        PIXEL_FORMAT_XRGB8888,      // native 32 bit 0xXXRRGGBB
+        PIXEL_FORMAT_RGB565         // native 16 bit
+    };
+
+    // completed frame handed out by the GPU, lines are stored top to bottom with pitch bytes each
+    struct gpu_frame {
+        std::vector<u8> image_data;
+        int width = 0;
+        int height = 0;
+        int pitch = 0;
+        pixel_formats format = PIXEL_FORMAT_RGBA8888;
+        // lines which changed compared to the previous frame (bit n % 64 of word n / 64)
+        std::vector<u64> dirty_lines;
+        int dirty_line_count = 0;
+        int frame_number = 0;
+    };
+
     enum console_ids {
         CONSOLE_NONE,
         GB,
@@ -276,6 +276,12 @@
 #define PPU_VRAM_BASEPTR_8000           0x8000
 #define PPU_VRAM_BASEPTR_8800           0x9000
 
+// background plane cache entry
+#define PPU_PLANE_COLOR_INDEX           0x03
+#define PPU_PLANE_PALETTE               0x1C
+#define PPU_PLANE_PALETTE_SHIFT         2
+#define PPU_PLANE_PRIO                  0x80
+
 // tile maps
 #define PPU_TILE_MAP0                   0x9800
 #define PPU_TILE_MAP1                   0x9C00
@@ -333,6 +339,9 @@
 #define CGB_DMG_COLOR_DARKGREY          0x545454ff
 #define CGB_DMG_COLOR_BLACK             0x000000ff
 
+#define DMG_COLORS_DMG                  0
+#define DMG_COLORS_CGB                  1
+
 #define PPU_DOTS_PER_FRAME              70224
 #define PPU_DOTS_PER_SCANLINE           (PPU_DOTS_PER_FRAME / LCD_SCANLINES_TOTAL)
 #define PPU_DOTS_MODE_2                 80
@@ -340,16 +349,26 @@
 #define PPU_DOTS_MODE_2_3               376
 #define PPU_DOTS_MODE_3_MIN             174     // 160 pixels + 6 clocks fill shift registers + 8 clocks shift out 8 pixels while fetching again
 #define PPU_OBJ_TILE_FETCH_TICKS        6
+#define PPU_DOTS_MODE_3_PIXEL_OFFSET    (PPU_DOTS_MODE_3_MIN - PPU_SCREEN_X)       // dots of mode 3 before the first pixel gets shifted out
+#define PPU_REG_WRITES_PER_LINE         48      // a write each machine cycle during mode 3 at most
 
 #define PPU_CGB_PALETTE_INDEX_INC       0x80
 #define PPU_CGB_RED                     0x001F
 #define PPU_CGB_GREEN                   0x03E0
 #define PPU_CGB_BLUE                    0x7C00
+#define PPU_CGB_COLOR_MASK              0x7FFF
+#define PPU_CGB_COLORS                  0x8000
+#define PPU_CGB_COLOR_CORRECTION_MAX    960     // channel sum limit of the color correction, scaled down by 4 to 8 bit
 
 /* ***********************************************************************************************************
     AUDIO DEFINES
 *********************************************************************************************************** */
 #define APU_CHANNELS_NUM                4
+#define APU_SAMPLE_RING_SIZE            16384                                                       // floats, 4096 frames of all channels
+#define APU_BLOCK_TICKS                 4096                                                        // ~1ms, band limited steps get integrated once per block
+#define APU_BLOCK_SAMPLES_MAX           1024
+#define APU_OFFLINE_SAMPLING_RATE       44100                                                       // Hz, fixed for reproducible offline rendering
+#define APU_OFFLINE_CHANNELS            4                                                           // 2 (stereo) or 4 (quad)
 
 #define APU_BASE_CLOCK                  512
 
@@ -373,9 +392,11 @@
 #define APU_DIV_BIT_SINGLESPEED          0x10        // bit 4
 #define APU_DIV_BIT_DOUBLESPEED          0x20        // bit 5
 
-#define ENVELOPE_SWEEP_TICK_RATE        8
-#define SOUND_LENGTH_TICK_RATE          2
-#define CH1_FREQU_SWEEP_RATE            4
+// frame sequencer steps (bit n = step n) on which the units get clocked
+#define APU_FRAME_SEQUENCER_STEPS       8
+#define APU_FRAME_SEQUENCER_LENGTH      0x55
+#define APU_FRAME_SEQUENCER_SWEEP       0x44
+#define APU_FRAME_SEQUENCER_ENVELOPE    0x80
 
 #define CH1_SWEEP_PACE                  0x70
 #define CH1_SWEEP_DIR                   0x08
@@ -399,6 +420,8 @@
 #define CH_1_2_3_PERIOD_FLIP            0x800
 #define CH_1_2_PERIOD_CLOCK             0x20000
 #define CH_1_2_PERIOD_THRESHOLD         0x7FF
+#define CH_1_2_TICKS_PER_STEP           4
+#define CH_3_TICKS_PER_STEP             2
 
 #define CH_LENGTH_TIMER_THRESHOLD       64
 
@@ -406,8 +429,6 @@
 
 #define CH_3_VOLUME                     0x60
 
-#define CH_3_WAVERAM_BUFFER_SIZE        8192
-
 #define CH_3_MAX_SAMPLING_RATE          (BASE_CLOCK_CPU / 2)
 
 #define CH_4_CLOCK_SHIFT                0xF0
@@ -424,11 +445,9 @@
 
 #define CH_4_LFSR_INIT_VALUE            0xFFFF
 
-#define CH_4_LFSR_MAX_SAMPL_RATE        (pow(2, 18) / (.5f * pow(2, 0)))
-
-#define CH_4_LFSR_BUFFER_SIZE           16384
+#define CH_4_LFSR_CLOCK_TICKS_MIN       8                                                           // divider 0 (treated as .5) * 16 ticks
+#define CH_4_LFSR_CLOCK_TICKS_PER_DIV   16
 
-#define CH_4_LFSR_TICKS_PER_APU_TICK    ((int)(BASE_CLOCK_CPU / APU_BASE_CLOCK))
 
 /* ***********************************************************************************************************
     REGISTERS INITIAL STATES
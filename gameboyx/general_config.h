@@ -35,6 +35,7 @@ namespace Config {
     inline const std::string SHADER_FOLDER = APPDATA_GBX + "shader/";
     inline const std::string SPIR_V_FOLDER = APPDATA_GBX + "shader/cache/";
     inline const std::string SAVE_FOLDER = APPDATA_GBX + "save/";
+    inline const std::string AUDIO_FOLDER = APPDATA_GBX + "audio/";
 #else
     inline const std::string ROM_FOLDER = "rom/";
     inline const std::string CONFIG_FOLDER = "config/";
@@ -42,15 +43,18 @@ namespace Config {
     inline const std::string SHADER_FOLDER = "shader/";
     inline const std::string SPIR_V_FOLDER = "shader/cache/";
     inline const std::string SAVE_FOLDER = "save/";
+    inline const std::string AUDIO_FOLDER = "audio/";
 #endif
 
     inline const std::string GAMES_CONFIG_FILE = "games.ini";
     inline const std::string DEBUG_INSTR_LOG = "_instructions.log";
+    inline const std::string BATCH_SUMMARY_FILE = "batch_summary.txt";
 
     inline const std::string CONTROL_FOLDER = "control/";
     inline const std::string CONTROL_DB = "gamecontrollerdb.txt";
 
     inline const std::string SAVE_EXT = ".sav";
+    inline const std::string AUDIO_EXT = ".wav";
 
     inline const std::string ICON_FOLDER = "icon/";
     inline const std::string ICON_FILE = "gameboyx.bmp";
@@ -84,6 +88,24 @@ namespace Config {
     inline const float APP_REVERB_DECAY_DEFAULT = .3f;
     inline const float APP_REVERB_DELAY_DEFAULT = .03f;
 
+    // audio clock pacing: fill level of the output buffer the emulation gets held at and the max. resampling adjustment
+    inline const float AUDIO_SYNC_TARGET_FILL = .25f;
+    inline const float AUDIO_SYNC_MAX_ADJUST = .005f;
+
+    // frame pacing: sleeps until the spin time before the deadline and yields for the rest, the timer slack of the
+    // OS only affects the sleep. Longer spins only help hosts with a coarse timer and keep a core busy meanwhile.
+    inline const int FRAME_PACER_SPIN_US = 300;
+    inline const int FRAME_PACER_SPIN_US_MAX = 2000;
+    inline const int FRAME_PACER_HISTOGRAM_BINS = 32;
+    inline const int FRAME_PACER_ERROR_BIN_US = 25;
+    inline const int FRAME_PACER_EMULATION_BIN_US = 500;
+
+    // run-ahead: frames emulated ahead of the presented one, each costs one more emulated frame per real frame
+    inline const int RUN_AHEAD_FRAMES_MAX = 3;
+
+    // catch-up: emulated frames per presented frame at most, a larger backlog (e.g. after a stall) gets dropped
+    inline const int CATCH_UP_FRAMES_MAX = 16;
+
     /* ***********************************************************************************************************
         IMGUI EMULATOR
     *********************************************************************************************************** */
@@ -187,16 +209,24 @@ namespace Config {
 #define FPS_SAMPLES_NUM             50
 
 #define DEBUG_INSTR_LINES           21
+#define DEBUG_CALLSTACK_DEPTH       64
 #define DEBUG_MEM_LINES             32
 #define DEBUG_MEM_ELEM_PER_LINE     0x10
 
-    inline const std::unordered_map<int, std::string> EMULATION_SPEEDS = {
-        {1, "x1"},
-        {2, "x2"},
-        {3, "x3"},
-        {4, "x4"},
-        {5, "x5"}
+    // factors of the native speed, EMULATION_SPEED_UNCAPPED runs as fast as the host allows
+    inline const float EMULATION_SPEED_UNCAPPED = .0f;
+    inline const std::vector<std::pair<float, std::string>> EMULATION_SPEEDS = {
+        {.25f, "x0.25"},
+        {.5f, "x0.5"},
+        {1.f, "x1"},
+        {1.5f, "x1.5"},
+        {2.f, "x2"},
+        {3.f, "x3"},
+        {4.f, "x4"},
+        {5.f, "x5"},
+        {EMULATION_SPEED_UNCAPPED, "Uncapped"}
     };
+    inline const int EMULATION_SPEED_DEFAULT_INDEX = 2;
 
     inline const ImGuiWindowFlags MAIN_WIN_FLAGS =
         ImGuiWindowFlags_NoTitleBar |
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <cctype>
 
 #include "logger.h"
 
@@ -38,4 +39,15 @@ namespace Helpers {
         size_t end = _in_string.find_last_not_of(WHITESPACE);
         return (end == string::npos) ? "" : _in_string.substr(0, end + 1);
     }
+
+    string sanitize_file_name(const string& _in_string) {
+        string name = trim(_in_string);
+        for (auto& n : name) {
+            if (!isalnum((u8)n) && n != ' ' && n != '-' && n != '_') {
+                n = '_';
+            }
+        }
+
+        return name.empty() ? "unnamed" : name;
+    }
 }
\ No newline at end of file
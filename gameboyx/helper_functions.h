@@ -16,4 +16,6 @@ namespace Helpers {
 	std::string trim(const std::string& _in_string);
 	std::string ltrim(const std::string& _in_string);
 	std::string rtrim(const std::string& _in_string);
+	// replaces everything but letters, digits, spaces, '-' and '_' so the result can be used as file name
+	std::string sanitize_file_name(const std::string& _in_string);
 }
\ No newline at end of file
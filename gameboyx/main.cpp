@@ -6,12 +6,15 @@
 #include <stdio.h>          // printf, fprintf
 #include <stdlib.h>         // abort
 #include <vector>
+#include <string>
+#include <thread>
 
 #include "GuiMgr.h"
 #include "logger.h"
 #include "general_config.h"
 #include "data_io.h"
 #include "HardwareMgr.h"
+#include "BatchRunner.h"
 
 using namespace std;
 
@@ -25,10 +28,21 @@ void create_fs_hierarchy();
  *  MAIN PROCEDURE
  *
 *********************************************************************************************************** */
-int main(int, char**)
+int main(int argc, char** argv)
 {
     create_fs_hierarchy();
 
+    // headless batch mode: gameboyx --batch <job file> [worker threads]
+    if (argc > 2 && std::string(argv[1]).compare("--batch") == 0) {
+        int workers = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+
+        std::vector<Emulation::batch_job> jobs;
+        if (!Emulation::BatchRunner::ReadJobs(argv[2], jobs)) { return -1; }
+
+        Emulation::BatchRunner runner(workers);
+        return runner.Run(jobs, Config::LOG_FOLDER + Config::BATCH_SUMMARY_FILE) == 0 ? 0 : -1;
+    }
+
     // todo: implement a config loader that loads configuration data and pass the data to the different application components
     //          and probably add a namespace that contains all the settings structs instead of passing them around
     Backend::graphics_settings s_graphics_settings = {};
@@ -105,4 +119,5 @@ void create_fs_hierarchy() {
     GUI::IO::check_and_create_shader_folders();
     GUI::IO::check_and_create_save_folders();
     GUI::IO::check_and_create_rom_folder();
+    GUI::IO::check_and_create_audio_folder();
 }
\ No newline at end of file